@@ -0,0 +1,268 @@
+#include "AutoMixEngine.h"
+
+//==============================================================================
+AutoMixEngine::Preloader::Preloader(AudioFormatManager& fm)
+    : Thread("Automix preloader"), formatManager(fm)
+{
+}
+
+AutoMixEngine::Preloader::~Preloader()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread(4000);
+}
+
+void AutoMixEngine::Preloader::request(const Track& track, double headSeconds)
+{
+    {
+        const ScopedLock sl(lock);
+        pending = std::make_unique<Track>(track);
+        pendingHeadSeconds = headSeconds;
+        busy = true;
+    }
+    notify();
+}
+
+bool AutoMixEngine::Preloader::isBusy() const
+{
+    const ScopedLock sl(lock);
+    return busy;
+}
+
+std::unique_ptr<AutoMixEngine::DecodedTrack> AutoMixEngine::Preloader::takeResult()
+{
+    const ScopedLock sl(lock);
+    return std::move(result);
+}
+
+void AutoMixEngine::Preloader::run()
+{
+    while (!threadShouldExit())
+    {
+        std::unique_ptr<Track> job;
+        double headSeconds;
+        {
+            const ScopedLock sl(lock);
+            job = std::move(pending);
+            headSeconds = pendingHeadSeconds;
+        }
+
+        if (job == nullptr)
+        {
+            wait(-1);
+            continue;
+        }
+
+        auto decoded = std::make_unique<DecodedTrack>();
+        decoded->track = *job;
+
+        std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(File(job->filePath)));
+        if (reader != nullptr && reader->lengthInSamples > 0 && reader->sampleRate > 0.0)
+        {
+            // Only the opening is decoded; holding whole tracks in memory is too much for long mixes
+            const int length = (int) jmin(reader->lengthInSamples, (int64) std::ceil(reader->sampleRate * headSeconds));
+            const int chunk = roundToInt(reader->sampleRate); // Decode a second at a time so shutdown stays responsive
+            auto buffer = std::make_unique<AudioBuffer<float>>(2, length);
+
+            int done = 0;
+            while (done < length && !threadShouldExit())
+            {
+                const int num = jmin(chunk, length - done);
+                reader->read(buffer.get(), done, num, done, true, true); // Mono files are copied to both channels
+                done += num;
+            }
+
+            if (done == length)
+            {
+                decoded->head = std::move(buffer);
+                decoded->reader = std::move(reader);
+            }
+        }
+
+        const ScopedLock sl(lock);
+        result = std::move(decoded);
+        busy = pending != nullptr;
+    }
+}
+
+//==============================================================================
+AutoMixEngine::AutoMixEngine(AudioFormatManager& formatManager, DJAudioPlayer& d1, DJAudioPlayer& d2)
+    : deck1(d1), deck2(d2), preloader(formatManager)
+{
+    preloader.startThread(Thread::Priority::low);
+    startTimer(50);
+}
+
+AutoMixEngine::~AutoMixEngine()
+{
+    stopTimer();
+}
+
+void AutoMixEngine::enqueue(const Track& track)
+{
+    queue.add(track);
+}
+
+void AutoMixEngine::setEnabled(bool shouldBeEnabled)
+{
+    enabled = shouldBeEnabled;
+
+    if (!enabled)
+    {
+        // Leave the active deck playing, but cancel any pending or running transition
+        // and give both decks their full level back for manual use
+        int state = transition.load(std::memory_order_acquire);
+
+        if (getPhase(state) == armed
+            && transition.compare_exchange_strong(state, makeState(noTransition, getActiveDeck(state)), std::memory_order_acq_rel))
+        {
+            getDeck(1 - getActiveDeck(state)).stop(); // Drop the held start on the idle deck
+        }
+        else if (getPhase(state) == handingOver) // The audio thread may have just got there first
+        {
+            transition.store(makeState(noTransition, getActiveDeck(state)), std::memory_order_release);
+            getDeck(1 - getActiveDeck(state)).stop(); // Cut the outgoing deck
+        }
+
+        handoverStartTime = 0.0;
+        deck1.fadeTo(1.0f, 0.0);
+        deck2.fadeTo(1.0f, 0.0);
+    }
+}
+
+//==============================================================================
+void AutoMixEngine::prepareToPlay(double sampleRate)
+{
+    currentSampleRate = sampleRate;
+}
+
+void AutoMixEngine::audioBlockStarting(int numSamples)
+{
+    int state = transition.load(std::memory_order_acquire);
+    if (getPhase(state) != armed)
+        return;
+
+    const int outgoingIndex = getActiveDeck(state);
+    auto& outgoing = getDeck(outgoingIndex);
+    auto& incoming = getDeck(1 - outgoingIndex);
+
+    const double fade = armedCrossfadeSeconds.load(std::memory_order_relaxed);
+    const double blockSeconds = numSamples / currentSampleRate.load(std::memory_order_relaxed);
+
+    if (!outgoing.isPlaying() || outgoing.getRemainingSeconds() > fade + blockSeconds)
+        return;
+
+    // Claim the crossfade; this fails if the message thread has just disarmed
+    if (!transition.compare_exchange_strong(state, makeState(handingOver, 1 - outgoingIndex), std::memory_order_acq_rel))
+        return;
+
+    // The incoming transport was started on the message thread when the deck was armed, so
+    // releasing it is one atomic store: no lock or change message here. It is heard from
+    // this block on, since the mixer has not begun rendering it yet
+    incoming.requestStart();
+    incoming.fadeTo(1.0f, fade);
+    outgoing.fadeTo(0.0f, fade);
+}
+
+//==============================================================================
+void AutoMixEngine::timerCallback()
+{
+    if (ready == nullptr)
+    {
+        ready = preloader.takeResult();
+
+        if (ready != nullptr && ready->reader == nullptr)
+            ready.reset(); // Unreadable file, skip it
+    }
+
+    // Keep exactly one track decoded ahead of the decks
+    if (ready == nullptr && !preloader.isBusy() && !queue.isEmpty())
+        preloader.request(queue.removeAndReturn(0), getHeadSeconds());
+
+    if (!enabled)
+        return;
+
+    const int state = transition.load(std::memory_order_acquire);
+    const int active = getActiveDeck(state);
+
+    if (getPhase(state) == handingOver)
+    {
+        auto& outgoing = getDeck(1 - active);
+        const double now = Time::getMillisecondCounterHiRes();
+
+        if (handoverStartTime == 0.0)
+            handoverStartTime = now;
+
+        if (!outgoing.isPlaying() || now - handoverStartTime > armedCrossfadeSeconds.load() * 1000.0 + 250.0)
+        {
+            outgoing.stop();
+            outgoing.fadeTo(1.0f, 0.0);
+            handoverStartTime = 0.0;
+            transition.store(makeState(noTransition, active), std::memory_order_release);
+        }
+        return;
+    }
+
+    auto& activePlayer = getDeck(active);
+
+    if (getPhase(state) == armed)
+    {
+        // The deck playing out was stopped before the crossfade point: the DJ has taken over
+        if (!activePlayer.isPlaying())
+        {
+            setEnabled(false);
+
+            if (onDisabled != nullptr)
+                onDisabled();
+        }
+        return;
+    }
+
+    if (!activePlayer.isPlaying())
+    {
+        // Nothing is playing: start the next track straight away
+        if (ready != nullptr)
+        {
+            activePlayer.fadeTo(1.0f, 0.0);
+            loadOntoDeck(active, std::move(ready));
+            activePlayer.start();
+        }
+        return;
+    }
+
+    if (ready != nullptr)
+    {
+        const int idle = 1 - active;
+        auto& incoming = getDeck(idle);
+        const Track& current = deckTracks[active];
+        double fade = crossfadeSeconds;
+
+        if (current.bpm > 0.0 && ready->track.bpm > 0.0)
+        {
+            // Match the incoming tempo to what the audience hears now, and fade over whole bars
+            const double speed = jlimit(0.5, 2.0, activePlayer.getSpeed() * current.bpm / ready->track.bpm);
+            incoming.setSpeed(speed);
+
+            const double secondsPerBar = 4.0 * 60.0 / (current.bpm * activePlayer.getSpeed());
+            fade = jmax(1.0, std::round(fade / secondsPerBar)) * secondsPerBar;
+        }
+
+        incoming.fadeTo(0.0f, 0.0);
+        loadOntoDeck(idle, std::move(ready));
+        incoming.armStart();
+        armedCrossfadeSeconds = fade;
+        transition.store(makeState(armed, active), std::memory_order_release);
+    }
+}
+
+void AutoMixEngine::loadOntoDeck(int deck, std::unique_ptr<DecodedTrack> decoded)
+{
+    auto& player = getDeck(deck);
+    player.setTrackGainDecibels(decoded->track.trackGainDb);
+    player.loadPreloaded(std::move(decoded->reader), std::move(decoded->head));
+    deckTracks[deck] = decoded->track;
+
+    if (onTrackLoaded != nullptr)
+        onTrackLoaded(deck + 1, decoded->track);
+}
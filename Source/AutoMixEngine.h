@@ -0,0 +1,123 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DJAudioPlayer.h"
+#include <atomic>
+#include <functional>
+
+//==============================================================================
+/**
+ * Plays a queue of tracks across the two decks without stopping.
+ *
+ * The opening of the next track is decoded into memory on a background thread
+ * while the current one plays, and loaded onto the idle deck ahead of time,
+ * where it is started but held silent; the rest of it streams from disk once
+ * it is playing. The handover itself is triggered from the audio thread
+ * (audioBlockStarting) so the incoming deck is released on the exact block the
+ * crossfade window opens, with no disk or codec work left to do at that point
+ * and nothing but atomic stores on the audio thread.
+ */
+class AutoMixEngine : private Timer
+{
+public:
+    struct Track
+    {
+        String filePath;
+        float trackGainDb = 0.0f; // Loudness normalisation offset
+        double bpm = 0.0;         // 0 when the tempo is unknown
+    };
+
+    AutoMixEngine(AudioFormatManager& formatManager, DJAudioPlayer& deck1, DJAudioPlayer& deck2);
+    ~AutoMixEngine() override;
+
+    /** Append a track to the end of the queue. */
+    void enqueue(const Track& track);
+    int getQueueLength() const { return queue.size() + (ready != nullptr ? 1 : 0); }
+
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const { return enabled; }
+
+    /** Crossfade length; rounded to whole bars when both tracks have a tempo. */
+    void setCrossfadeSeconds(double seconds) { crossfadeSeconds = jmax(0.0, seconds); }
+
+    /** Called when automix puts a track on a deck (1 or 2), so the deck GUI can follow. */
+    std::function<void(int deckIndex, const Track& track)> onTrackLoaded;
+
+    /** Called when automix turns itself off because the playing deck was stopped by hand. */
+    std::function<void()> onDisabled;
+
+    //==============================================================================
+    /** Audio thread: call once per block before the decks are rendered. */
+    void prepareToPlay(double sampleRate);
+    void audioBlockStarting(int numSamples);
+
+private:
+    struct DecodedTrack
+    {
+        Track track;
+        std::unique_ptr<AudioFormatReader> reader; // Streams the rest once the head has played
+        std::unique_ptr<AudioBuffer<float>> head;  // The opening, decoded
+    };
+
+    /** Decodes the opening of one requested track at a time into memory. */
+    class Preloader : public Thread
+    {
+    public:
+        explicit Preloader(AudioFormatManager& formatManager);
+        ~Preloader() override;
+
+        void request(const Track& track, double headSeconds);
+        bool isBusy() const;
+        std::unique_ptr<DecodedTrack> takeResult();
+        void run() override;
+
+    private:
+        AudioFormatManager& formatManager;
+        CriticalSection lock;
+        std::unique_ptr<Track> pending;
+        double pendingHeadSeconds = 0.0;
+        std::unique_ptr<DecodedTrack> result;
+        bool busy = false;
+    };
+
+    // Transition state shared with the audio thread. The phase and the active deck live in one
+    // atomic so neither thread ever sees one without the other. Only the audio thread moves
+    // armed to handingOver; every other change is made on the message thread.
+    enum Phase
+    {
+        noTransition = 0,
+        armed = 1,       // Idle deck is loaded, started and held, waiting for the crossfade point
+        handingOver = 2  // Audio thread has started the crossfade
+    };
+
+    static int makeState(Phase phase, int deck) { return ((int) phase << 1) | deck; }
+    static Phase getPhase(int state) { return (Phase) (state >> 1); }
+    static int getActiveDeck(int state) { return state & 1; }
+
+    /** Seconds of the next track to decode ahead: the crossfade, which bar rounding can lengthen
+        and a faster incoming tempo gets through quicker, plus time for the streaming to catch up */
+    double getHeadSeconds() const { return 2.0 * crossfadeSeconds + 4.0; }
+
+    void timerCallback() override;
+    void loadOntoDeck(int deck, std::unique_ptr<DecodedTrack> decoded);
+    DJAudioPlayer& getDeck(int index) { return index == 0 ? deck1 : deck2; }
+
+    DJAudioPlayer& deck1;
+    DJAudioPlayer& deck2;
+    Preloader preloader;
+
+    Array<Track> queue; // Tracks not yet handed to the preloader
+    std::unique_ptr<DecodedTrack> ready; // Decoded and waiting for a free deck
+    bool enabled = false;
+    double crossfadeSeconds = 8.0;
+
+    Track deckTracks[2]; // What each deck was last given, for tempo matching
+    double handoverStartTime = 0.0; // Message-thread time the last crossfade began
+
+    // Shared with the audio thread
+    std::atomic<int> transition{ makeState(noTransition, 0) };
+    std::atomic<double> armedCrossfadeSeconds{ 0.0 };
+    std::atomic<double> currentSampleRate{ 44100.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AutoMixEngine)
+};
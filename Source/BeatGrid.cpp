@@ -0,0 +1,178 @@
+#include "BeatGrid.h"
+#include <numeric>
+
+//==============================================================================
+BeatGrid BeatGrid::estimate(const std::vector<float>& lowBandEnvelope, double pointsPerSecond)
+{
+    constexpr double minBpm = 85.0, maxBpm = 175.0;
+    constexpr int maxWindow = 1 << 16;
+
+    const int minLag = (int) std::floor(pointsPerSecond * 60.0 / maxBpm);
+    const int maxLag = (int) std::ceil(pointsPerSecond * 60.0 / minBpm);
+    const int total = (int) lowBandEnvelope.size();
+
+    if (minLag < 2 || total < maxLag * 8)
+        return {};
+
+    // Analyse the middle of the track, where intros and outros are least likely to throw the tempo off
+    const int n = jmin(total, maxWindow);
+    const int windowStart = (total - n) / 2;
+
+    // Onset strength: rises in bass amplitude, with the mean removed
+    std::vector<float> onsets((size_t) n, 0.0f);
+    for (int i = 1; i < n; ++i)
+    {
+        const float previous = std::sqrt(lowBandEnvelope[(size_t) (windowStart + i - 1)]);
+        const float current = std::sqrt(lowBandEnvelope[(size_t) (windowStart + i)]);
+        onsets[(size_t) i] = jmax(0.0f, current - previous);
+    }
+
+    const float mean = std::accumulate(onsets.begin(), onsets.end(), 0.0f) / n;
+    FloatVectorOperations::add(onsets.data(), -mean, n);
+
+    auto autocorrelation = [&onsets, n](int lag)
+    {
+        double sum = 0.0;
+        for (int i = 0; i + lag < n; ++i)
+            sum += onsets[(size_t) i] * onsets[(size_t) (i + lag)];
+        return sum / (n - lag);
+    };
+
+    // Score each beat period together with its bar-level double, which favours the true tempo over half-time
+    std::vector<double> scores((size_t) (maxLag + 2), 0.0);
+    for (int lag = minLag - 1; lag <= maxLag + 1; ++lag)
+        scores[(size_t) lag] = autocorrelation(lag) + 0.5 * autocorrelation(lag * 2);
+
+    int best = minLag;
+    for (int lag = minLag; lag <= maxLag; ++lag)
+        if (scores[(size_t) lag] > scores[(size_t) best])
+            best = lag;
+
+    if (scores[(size_t) best] <= 0.0)
+        return {};
+
+    // Parabolic interpolation between neighbouring lags for a fractional period
+    const double a = scores[(size_t) (best - 1)], b = scores[(size_t) best], c = scores[(size_t) (best + 1)];
+    const double denominator = a - 2.0 * b + c;
+    const double period = best + (denominator != 0.0 ? jlimit(-0.5, 0.5, 0.5 * (a - c) / denominator) : 0.0);
+
+    // Phase: fold the onsets onto one period and take the strongest position
+    const int numBins = jmax(1, roundToInt(period));
+    std::vector<double> histogram((size_t) numBins, 0.0);
+    for (int i = 0; i < n; ++i)
+        histogram[(size_t) ((int) (std::fmod(i, period) / period * numBins) % numBins)] += onsets[(size_t) i];
+
+    const int phaseBin = (int) (std::max_element(histogram.begin(), histogram.end()) - histogram.begin());
+    const double firstBeatPoint = std::fmod(windowStart + phaseBin * period / numBins, period);
+
+    BeatGrid grid;
+    grid.bpm = std::round(60.0 * pointsPerSecond / period * 100.0) / 100.0;
+    grid.firstBeatSeconds = firstBeatPoint / pointsPerSecond;
+    return grid;
+}
+
+//==============================================================================
+void BeatGridOverlay::update(const BeatGrid& grid, double sampleRate, double samplesPerPixel, int64 lengthInSamples)
+{
+    if (grid.bpm == cachedGrid.bpm && grid.firstBeatSeconds == cachedGrid.firstBeatSeconds
+        && samplesPerPixel == cachedSamplesPerPixel)
+        return;
+
+    cachedGrid = grid;
+    cachedSamplesPerPixel = samplesPerPixel;
+    lines.clear();
+
+    if (!grid.isValid() || samplesPerPixel <= 0.0 || sampleRate <= 0.0)
+        return;
+
+    const double columnsPerBeat = grid.getSecondsPerBeat() * sampleRate / samplesPerPixel;
+    const double firstColumn = grid.firstBeatSeconds * sampleRate / samplesPerPixel;
+    const double lastColumn = lengthInSamples / samplesPerPixel;
+
+    // Thin out to bars, then to every 2nd, 4th, ... bar, until the lines are at least 4 px apart
+    constexpr double minSpacing = 4.0;
+    int beatStep = 1;
+    while (columnsPerBeat * beatStep < minSpacing)
+        beatStep = beatStep == 1 ? 4 : beatStep * 2;
+
+    // Bar numbers need about 24 px of room each
+    labelEvery = 1;
+    while (columnsPerBeat * 4.0 * labelEvery < 24.0)
+        labelEvery *= 2;
+
+    lines.reserve((size_t) jmax(0.0, (lastColumn - firstColumn) / (columnsPerBeat * beatStep)) + 1);
+
+    for (int beat = 0; ; beat += beatStep)
+    {
+        const double column = firstColumn + beat * columnsPerBeat;
+        if (column > lastColumn)
+            break;
+
+        const bool isBar = beat % 4 == 0;
+        lines.push_back({ column, isBar ? beat / 4 + 1 : 0 });
+    }
+}
+
+void BeatGridOverlay::draw(Graphics& g, Rectangle<int> area, int64 firstColumn, Colour colour) const
+{
+    if (lines.empty())
+        return;
+
+    Graphics::ScopedSaveState state(g);
+    g.reduceClipRegion(area);
+    g.setFont(9.0f);
+
+    // Labels hang to the right of their line, so start a little to the left of the area
+    constexpr double labelWidth = 24.0;
+    const double start = (double) firstColumn - labelWidth;
+    const double end = (double) firstColumn + area.getWidth();
+
+    auto line = std::lower_bound(lines.begin(), lines.end(), start,
+        [](const Line& l, double column) { return l.column < column; });
+
+    for (; line != lines.end() && line->column < end; ++line)
+    {
+        const float x = (float) (area.getX() + (line->column - (double) firstColumn));
+
+        g.setColour(colour.withAlpha(line->barNumber > 0 ? 0.6f : 0.25f));
+        g.fillRect(x, (float) area.getY(), 1.0f, (float) area.getHeight());
+
+        if (line->barNumber > 0 && (line->barNumber - 1) % labelEvery == 0)
+        {
+            g.setColour(colour.withAlpha(0.8f));
+            g.drawText(String(line->barNumber), Rectangle<float>(x + 2.0f, (float) area.getY(), (float) labelWidth, 10.0f),
+                Justification::centredLeft, false);
+        }
+    }
+}
+
+void BeatGridOverlay::drawCues(Graphics& g, Rectangle<int> area, int64 firstColumn, double columnsPerTrack,
+    const Array<double>& cuePositions)
+{
+    Graphics::ScopedSaveState state(g);
+    g.reduceClipRegion(area);
+    g.setFont(9.0f);
+
+    for (int i = 0; i < cuePositions.size(); ++i)
+    {
+        if (cuePositions[i] < 0.0)
+            continue;
+
+        const float x = (float) (area.getX() + cuePositions[i] * columnsPerTrack - (double) firstColumn);
+
+        if (x < area.getX() - 10.0f || x > area.getRight() + 10.0f)
+            continue;
+
+        g.setColour(Colours::yellow.withAlpha(0.8f));
+        g.fillRect(x, (float) area.getY(), 1.0f, (float) area.getHeight());
+
+        // Flag at the bottom of the line carrying the cue number
+        Path flag;
+        const float bottom = (float) area.getBottom();
+        flag.addTriangle(x, bottom - 12.0f, x + 9.0f, bottom - 6.0f, x, bottom);
+        g.fillPath(flag);
+
+        g.setColour(Colours::black);
+        g.drawText(String(i + 1), Rectangle<float>(x, bottom - 12.0f, 7.0f, 12.0f), Justification::centred, false);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <vector>
+
+//==============================================================================
+/** A constant-tempo 4/4 grid: beat n falls at firstBeatSeconds + n * 60 / bpm. */
+struct BeatGrid
+{
+    double bpm = 0.0;              // 0 when no tempo could be found
+    double firstBeatSeconds = 0.0; // Earliest beat at or after the start of the track
+
+    bool isValid() const { return bpm > 0.0; }
+    double getSecondsPerBeat() const { return 60.0 / bpm; }
+
+    /**
+     * Estimate the tempo and phase from a bass-energy envelope (one value per
+     * point, pointsPerSecond apart) by autocorrelating its onsets over the
+     * 85-175 BPM range. Returns an invalid grid for tracks without a steady beat.
+     */
+    static BeatGrid estimate(const std::vector<float>& lowBandEnvelope, double pointsPerSecond);
+};
+
+//==============================================================================
+/**
+ * Beat lines, bar numbers and cue markers drawn over a waveform.
+ *
+ * The line positions are worked out once per zoom level, in absolute pixel
+ * columns from the start of the track, and thinned out so lines are never
+ * closer than a few pixels. Drawing a window then only visits the lines that
+ * fall inside it, however many beats the track has.
+ */
+class BeatGridOverlay
+{
+public:
+    /** Recompute the lines if the grid or zoom has changed; cheap to call on every paint. */
+    void update(const BeatGrid& grid, double sampleRate, double samplesPerPixel, int64 lengthInSamples);
+
+    /** Draw the lines that fall in the area. Absolute column c is drawn at area x = c - firstColumn. */
+    void draw(Graphics& g, Rectangle<int> area, int64 firstColumn, Colour colour) const;
+
+    /**
+     * Draw hot-cue markers. Positions are relative (0..1) with negative meaning unset;
+     * each marker is labelled with its index + 1.
+     */
+    static void drawCues(Graphics& g, Rectangle<int> area, int64 firstColumn, double columnsPerTrack,
+        const Array<double>& cuePositions);
+
+private:
+    struct Line
+    {
+        double column;
+        int barNumber; // 1-based; 0 for beats that aren't the first of a bar
+    };
+
+    std::vector<Line> lines; // Sorted by column
+    BeatGrid cachedGrid;
+    double cachedSamplesPerPixel = 0.0;
+    int labelEvery = 1; // Bars between labelled bar numbers at this zoom
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "PaintProfiler.h"
 
 // CustomLookAndFeel class to provide custom drawing for various UI components
 class CustomLookAndFeel : public LookAndFeel_V4
@@ -18,6 +19,7 @@ public:
         float sliderPosProportional, float rotaryStartAngle,
         float rotaryEndAngle, Slider& slider) override
     {
+        OTODECKS_PROFILE_PAINT("CustomLookAndFeel::drawRotarySlider");
         Colour fillColour = knobColor;
         Colour outlineColour = knobColor;
         Colour ringColour = ringColor;
@@ -91,7 +93,7 @@ public:
         if (shouldDrawButtonAsHighlighted)
             baseColour = indicatorColor.darker();
 
-        if (shouldDrawButtonAsDown)
+        if (shouldDrawButtonAsDown || button.getToggleState())
             baseColour = indicatorColor;
 
         const float cornerSize = 0.0f;
@@ -14,22 +14,134 @@ Author:  matthew
 DJAudioPlayer::DJAudioPlayer(AudioFormatManager& _formatManager) 
 : formatManager(_formatManager)
 {
-
+    readAheadThread.startThread();
 }
 DJAudioPlayer::~DJAudioPlayer()
 {
-
+    // Detach the transport before the sources it reads from are destroyed
+    transportSource.setSource(nullptr);
 }
 
 void DJAudioPlayer::prepareToPlay (int samplesPerBlockExpected, double sampleRate) 
 {
     transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
     resampleSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    loudnessMeter.prepare(sampleRate, samplesPerBlockExpected);
+    meterTap.prepare(sampleRate);
+    currentSampleRate = sampleRate;
 }
 void DJAudioPlayer::getNextAudioBlock (const AudioSourceChannelInfo& bufferToFill)
 {
+    renderBlock(bufferToFill, nullptr);
+}
+void DJAudioPlayer::getNextAudioBlock (const AudioSourceChannelInfo& bufferToFill, const AudioSourceChannelInfo& preFader)
+{
+    renderBlock(bufferToFill, &preFader);
+}
+void DJAudioPlayer::renderBlock(const AudioSourceChannelInfo& bufferToFill, const AudioSourceChannelInfo* preFader)
+{
+    // An armed deck fades in from silence, whatever level it was left at. Flagged rather than left to
+    // fadeTarget, which may already be back at 1 by the time the audio thread first looks
+    if (fadeFromSilence.load(std::memory_order_acquire) && fadeFromSilence.exchange(false, std::memory_order_acq_rel))
+    {
+        fadeGain.setCurrentAndTargetValue(0.0f);
+        lastBlockGain = 0.0f;
+    }
+
+    // An armed deck stays silent and keeps its place until its start is requested
+    if (startHeld.load(std::memory_order_acquire))
+    {
+        bufferToFill.clearActiveBufferRegion();
+        if (preFader != nullptr)
+            preFader->clearActiveBufferRegion();
+        publishPlayhead();
+        return;
+    }
+
     resampleSource.getNextAudioBlock(bufferToFill);
 
+    // Pick up a new automix fade, continuing from wherever the current one has got to
+    const float target = fadeTarget.load(std::memory_order_acquire);
+    if (target != fadeGain.getTargetValue())
+    {
+        fadeGain.setCurrentAndTargetValue(fadeGain.getCurrentValue());
+        fadeGain.reset(currentSampleRate, fadeSeconds.load(std::memory_order_relaxed));
+        fadeGain.setTargetValue(target);
+    }
+    fadeGain.skip(bufferToFill.numSamples);
+
+    // The cue bus hears the deck after normalisation but before the volume and automix faders
+    const float normalisation = trackGain.load(std::memory_order_relaxed);
+    if (preFader != nullptr)
+    {
+        auto& cue = *preFader->buffer;
+        for (int chan = 0; chan < cue.getNumChannels(); ++chan)
+            cue.copyFromWithRamp(chan, preFader->startSample,
+                bufferToFill.buffer->getReadPointer(jmin(chan, bufferToFill.buffer->getNumChannels() - 1), bufferToFill.startSample),
+                jmin(bufferToFill.numSamples, preFader->numSamples), lastTrackGain, normalisation);
+    }
+    lastTrackGain = normalisation;
+
+    // The fade is linear, so one gain ramp per block applies it exactly along with the
+    // fader and normalisation gains, which are also ramped to avoid zipper noise
+    const float gain = normalisation * faderGain.load(std::memory_order_relaxed) * fadeGain.getCurrentValue();
+    bufferToFill.buffer->applyGainRamp(bufferToFill.startSample, bufferToFill.numSamples, lastBlockGain, gain);
+    lastBlockGain = gain;
+
+    loudnessMeter.process(bufferToFill);
+    meterTap.process(bufferToFill);
+    publishPlayhead();
+}
+
+void DJAudioPlayer::publishPlayhead()
+{
+    const double length = transportSource.getLengthInSeconds();
+    const double position = length > 0.0 ? transportSource.getCurrentPosition() / length : 0.0;
+    const double rate = length > 0.0 && isPlaying() ? getSpeed() / length : 0.0;
+
+    const uint32 sequence = playheadSequence.load(std::memory_order_relaxed);
+    playheadSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    playheadPosition.store(position, std::memory_order_relaxed);
+    playheadRate.store(rate, std::memory_order_relaxed);
+    playheadTimestamp.store(Time::getMillisecondCounterHiRes(), std::memory_order_relaxed);
+    playheadLength.store(length, std::memory_order_relaxed);
+
+    playheadSequence.store(sequence + 2, std::memory_order_release);
+}
+
+DJAudioPlayer::PlayheadSnapshot DJAudioPlayer::getPlayheadSnapshot() const
+{
+    PlayheadSnapshot snapshot;
+
+    // The writer never blocks; a reader that overlaps a write just reads again
+    for (;;)
+    {
+        const uint32 before = playheadSequence.load(std::memory_order_acquire);
+
+        snapshot.positionRelative = playheadPosition.load(std::memory_order_relaxed);
+        snapshot.relativePerSecond = playheadRate.load(std::memory_order_relaxed);
+        snapshot.timestampMs = playheadTimestamp.load(std::memory_order_relaxed);
+        snapshot.lengthSeconds = playheadLength.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if ((before & 1) == 0 && before == playheadSequence.load(std::memory_order_relaxed))
+            return snapshot;
+    }
+}
+
+double DJAudioPlayer::PlayheadSnapshot::getPositionRelativeAt(double nowMs) const
+{
+    // Cap the extrapolation so a stalled or stopped device can't run the playhead away
+    const double elapsedSeconds = jlimit(0.0, 0.1, (nowMs - timestampMs) * 0.001);
+    return jlimit(0.0, 1.0, positionRelative + relativePerSecond * elapsedSeconds);
+}
+
+double DJAudioPlayer::getInterpolatedPositionRelative() const
+{
+    return getPlayheadSnapshot().getPositionRelativeAt(Time::getMillisecondCounterHiRes());
 }
 void DJAudioPlayer::releaseResources()
 {
@@ -46,8 +158,22 @@ void DJAudioPlayer::loadURL(URL audioURL)
 true)); 
         transportSource.setSource (newSource.get(), 0, nullptr, reader->sampleRate);             
         readerSource.reset (newSource.release());          
+        preloadedSource.reset();
     }
 }
+void DJAudioPlayer::loadPreloaded(std::unique_ptr<AudioFormatReader> reader, std::unique_ptr<AudioBuffer<float>> head)
+{
+    if (reader == nullptr || head == nullptr)
+        return;
+
+    const double sampleRate = reader->sampleRate;
+    auto newSource = std::make_unique<PreloadedAudioSource>(std::move(reader), std::move(head), readAheadThread);
+    transportSource.setSource(newSource.get(), 0, nullptr, sampleRate);
+
+    // Only release the old sources once the transport has stopped using them
+    preloadedSource = std::move(newSource);
+    readerSource.reset();
+}
 void DJAudioPlayer::setGain(double gain)
 {
     if (gain < 0 || gain > 1.0)
@@ -55,10 +181,19 @@ void DJAudioPlayer::setGain(double gain)
         std::cout << "DJAudioPlayer::setGain gain should be between 0 and 1" << std::endl;
     }
     else {
-        transportSource.setGain(gain);
+        faderGain = (float) gain; // Applied in getNextAudioBlock, after the cue bus's pre-fader copy
     }
    
 }
+void DJAudioPlayer::setTrackGainDecibels(float gainDb)
+{
+    trackGain = Decibels::decibelsToGain(gainDb);
+}
+void DJAudioPlayer::fadeTo(float targetGain, double seconds)
+{
+    fadeSeconds.store((float) seconds, std::memory_order_relaxed);
+    fadeTarget.store(targetGain, std::memory_order_release);
+}
 void DJAudioPlayer::setSpeed(double ratio)
 {
   if (ratio < 0 || ratio > 100.0)
@@ -90,19 +225,42 @@ void DJAudioPlayer::setPositionRelative(double pos)
 
 void DJAudioPlayer::start()
 {
+    startHeld = false;
     transportSource.start();
 }
 void DJAudioPlayer::stop()
 {
+  startHeld = false;
   transportSource.stop();
 }
+void DJAudioPlayer::armStart()
+{
+    fadeFromSilence.store(true, std::memory_order_release);
+    startHeld = true;
+    transportSource.start();
+}
+void DJAudioPlayer::requestStart()
+{
+    startHeld.store(false, std::memory_order_release);
+}
 
 double DJAudioPlayer::getPositionRelative()
 {
     return transportSource.getCurrentPosition() / transportSource.getLengthInSeconds();
 }
 
+double DJAudioPlayer::getRemainingSeconds()
+{
+    const double remaining = transportSource.getLengthInSeconds() - transportSource.getCurrentPosition();
+    return jmax(0.0, remaining) / jmax(0.01, getSpeed());
+}
+
+double DJAudioPlayer::getSpeed()
+{
+    return resampleSource.getResamplingRatio();
+}
+
 bool DJAudioPlayer::isPlaying()
 {
-    return transportSource.isPlaying();
+    return transportSource.isPlaying() && !startHeld.load(std::memory_order_acquire);
 }
\ No newline at end of file
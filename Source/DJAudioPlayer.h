@@ -11,8 +11,14 @@
 #pragma once
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "LoudnessMeter.h"
+#include "LevelMeter.h"
+#include "PreloadedAudioSource.h"
+#include "ParallelMixerAudioSource.h"
+#include <atomic>
 
-class DJAudioPlayer : public AudioSource {
+class DJAudioPlayer : public AudioSource,
+                      public ParallelMixerAudioSource::PreFaderSource {
   public:
 
     DJAudioPlayer(AudioFormatManager& _formatManager);
@@ -22,7 +28,13 @@ class DJAudioPlayer : public AudioSource {
     void getNextAudioBlock (const AudioSourceChannelInfo& bufferToFill) override;
     void releaseResources() override;
 
+    /** render as usual, and copy the block into preFader before the volume and automix faders; for the cue bus */
+    void getNextAudioBlock (const AudioSourceChannelInfo& bufferToFill, const AudioSourceChannelInfo& preFader) override;
+
     void loadURL(URL audioURL);
+    /** play a track whose opening has already been decoded into head, so starting it costs no disk or codec time;
+        the rest streams from the reader */
+    void loadPreloaded(std::unique_ptr<AudioFormatReader> reader, std::unique_ptr<AudioBuffer<float>> head);
     void setGain(double gain);
     void setSpeed(double ratio);
     void setPosition(double posInSecs);
@@ -32,15 +44,84 @@ class DJAudioPlayer : public AudioSource {
     void start();
     void stop();
 
+    /** start the transport but hold the deck silent at its position until requestStart(); message thread only */
+    void armStart();
+
+    /** release a deck held by armStart() from its next block; a single atomic store, so safe on the audio thread */
+    void requestStart();
+
     /** get the relative position of the playhead */
     double getPositionRelative();
 
+    /** set the per-track loudness normalisation offset, applied on top of the deck volume */
+    void setTrackGainDecibels(float gainDb);
+
+    /** ramp the automix fader to targetGain over the given time; safe to call from any thread */
+    void fadeTo(float targetGain, double seconds);
+
+    /** wall-clock time left before the track ends at the current speed */
+    double getRemainingSeconds();
+    double getSpeed();
+
+    /** post-fader loudness of this deck, for the deck's LUFS meter */
+    const LoudnessMeter& getLoudnessMeter() const { return loudnessMeter; }
+
+    /** post-fader peak/RMS and spectrum feed for this deck's meters */
+    MeterTap& getMeterTap() { return meterTap; }
+
+    /** where the audio thread had got to at the end of its last block, and when */
+    struct PlayheadSnapshot
+    {
+        double positionRelative = 0.0;
+        double relativePerSecond = 0.0; // How fast positionRelative advances in wall-clock time; 0 when stopped
+        double timestampMs = 0.0;       // Time::getMillisecondCounterHiRes() at publication
+        double lengthSeconds = 0.0;
+
+        /** extrapolate to a Time::getMillisecondCounterHiRes() value */
+        double getPositionRelativeAt(double nowMs) const;
+    };
+
+    /** lock-free read of the latest snapshot; safe from any thread */
+    PlayheadSnapshot getPlayheadSnapshot() const;
+
+    /** playhead extrapolated from the audio clock to the current time, for smooth animation */
+    double getInterpolatedPositionRelative() const;
+
 private:
     AudioFormatManager& formatManager;
+    TimeSliceThread readAheadThread{ "Deck read-ahead" }; // Streams preloaded tracks; outlives preloadedSource
     std::unique_ptr<AudioFormatReaderSource> readerSource;
     AudioTransportSource transportSource; 
     ResamplingAudioSource resampleSource{&transportSource, false, 2};
 
+    std::unique_ptr<PreloadedAudioSource> preloadedSource;
+
+    std::atomic<float> trackGain{ 1.0f }; // Normalisation gain, written by the message thread
+    std::atomic<float> faderGain{ 1.0f }; // Volume fader, written by the message thread
+    std::atomic<float> fadeTarget{ 1.0f }; // Automix fader target
+    std::atomic<float> fadeSeconds{ 0.0f }; // Ramp time for the next fadeTarget change
+    SmoothedValue<float> fadeGain{ 1.0f }; // Audio-thread side of the automix fader
+    float lastBlockGain = 1.0f; // Gain applied at the end of the previous block, for ramping
+    float lastTrackGain = 1.0f; // Normalisation gain at the end of the previous block, for the pre-fader ramp
+    std::atomic<bool> startHeld{ false }; // Transport started by armStart() but still waiting for requestStart()
+    std::atomic<bool> fadeFromSilence{ false }; // Set by armStart(): the audio thread restarts the automix fader at 0
+    double currentSampleRate = 44100.0;
+    LoudnessMeter loudnessMeter;
+    MeterTap meterTap;
+
+    /** Audio thread: render a block, copying it into preFader before the faders if that is not null */
+    void renderBlock(const AudioSourceChannelInfo& bufferToFill, const AudioSourceChannelInfo* preFader);
+
+    /** Audio thread: publish the playhead once the block has been rendered */
+    void publishPlayhead();
+
+    // Seqlock around the snapshot: odd while the audio thread is writing it
+    std::atomic<uint32> playheadSequence{ 0 };
+    std::atomic<double> playheadPosition{ 0.0 };
+    std::atomic<double> playheadRate{ 0.0 };
+    std::atomic<double> playheadTimestamp{ 0.0 };
+    std::atomic<double> playheadLength{ 0.0 };
+
 };
 
 
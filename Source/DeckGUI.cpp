@@ -1,12 +1,13 @@
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "DeckGUI.h"
+#include "PaintProfiler.h"
 #include "GlobalStateManager.h" // Include your StateManager header
 #include <cmath>
 
 //==============================================================================
 DeckGUI::DeckGUI(DJAudioPlayer* _player,
     AudioFormatManager& formatManagerToUse,
-    AudioThumbnailCache& cacheToUse,
+    WaveformCache& cacheToUse,
     int& playerIndex,
     Colour knobColor,
     Colour ringColor,
@@ -17,9 +18,12 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player,
     Colour buttonOnColor)
     : player(_player),
     waveformDisplay(formatManagerToUse, cacheToUse, &posSlider, Colours::black, Colours::grey, ringColor, Colours::red),
+    zoomedWaveform(*_player, ringColor),
     playerIndex(playerIndex),
     customLookAndFeel(knobColor, ringColor, indicatorColor, trackColor, thumbColor, buttonColor, buttonOnColor),
-    rotatingDeck(indicatorColor)
+    rotatingDeck(indicatorColor),
+    loudnessMeter(_player->getLoudnessMeter(), ringColor),
+    levelMeter(_player->getMeterTap(), ringColor)
 {
     angle = 0.0;
     fileNameLabel.setJustificationType(Justification::centred);
@@ -43,6 +47,8 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player,
     playButton.addListener(this);
     stopButton.addListener(this);
     loadButton.addListener(this);
+    cueButton.addListener(this);
+    cueButton.setClickingTogglesState(true);
 
     for(auto& button : qButton) {
 		button.addListener(this);
@@ -80,6 +86,7 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player,
     addAndMakeVisible(playButton);
     addAndMakeVisible(stopButton);
     addAndMakeVisible(loadButton);
+    addAndMakeVisible(cueButton);
     addAndMakeVisible(volSlider);
     addAndMakeVisible(speedSlider);
     addAndMakeVisible(posSlider);
@@ -87,7 +94,10 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player,
     addAndMakeVisible(speedLabel);
     addAndMakeVisible(seekLabel);
     addAndMakeVisible(waveformDisplay);
+    addAndMakeVisible(zoomedWaveform);
     addAndMakeVisible(rotatingDeck);
+    addAndMakeVisible(loudnessMeter);
+    addAndMakeVisible(levelMeter);
 
     for (TextButton& button : qButton) {
         addAndMakeVisible(button);
@@ -98,18 +108,16 @@ DeckGUI::DeckGUI(DJAudioPlayer* _player,
     }
 
     // Set the DJAudioPlayer as the listener for the waveform display
-
-    startTimer(100);
 }
 
 DeckGUI::~DeckGUI()
 {
     setLookAndFeel(nullptr);
-    stopTimer();
 }
 
 void DeckGUI::paint(Graphics& g)
 {
+    OTODECKS_PROFILE_PAINT("DeckGUI::paint");
     if (!isShowing())
     {
         DBG("lol");
@@ -170,10 +178,12 @@ void DeckGUI::resized()
     playButton.setBounds(0, 0, buttonSize, buttonSize);
     stopButton.setBounds(0, 0, buttonSize, buttonSize);
     loadButton.setBounds(0, 0, buttonSize, buttonSize);
+    cueButton.setBounds(0, 0, buttonSize, buttonSize);
 
     buttonFlexBox.items.add(juce::FlexItem(playButton).withFlex(1).withMinWidth(buttonSize).withMinHeight(buttonSize));
     buttonFlexBox.items.add(juce::FlexItem(stopButton).withFlex(1).withMinWidth(buttonSize).withMinHeight(buttonSize));
     buttonFlexBox.items.add(juce::FlexItem(loadButton).withFlex(1).withMinWidth(buttonSize).withMinHeight(buttonSize));
+    buttonFlexBox.items.add(juce::FlexItem(cueButton).withFlex(1).withMinWidth(buttonSize).withMinHeight(buttonSize));
 
     if (playerIndex == 1) {
         fileFlexBox.items.add(juce::FlexItem(waveformDisplay).withFlex(10));
@@ -193,8 +203,12 @@ void DeckGUI::resized()
         deckFlexbox.items.add(juce::FlexItem(qButtonFlexBox).withFlex(0.75).withMargin(2.0f));
         deckFlexbox.items.add(juce::FlexItem(rotatingDeck).withFlex(4).withMargin(2.0f));
         deckFlexbox.items.add(juce::FlexItem(sliderFlexBox).withFlex(2));
+        deckFlexbox.items.add(juce::FlexItem(levelMeter).withFlex(0.2).withMargin(2.0f));
+        deckFlexbox.items.add(juce::FlexItem(loudnessMeter).withFlex(0.3).withMargin(2.0f));
     }
     else {
+        deckFlexbox.items.add(juce::FlexItem(loudnessMeter).withFlex(0.3).withMargin(2.0f));
+        deckFlexbox.items.add(juce::FlexItem(levelMeter).withFlex(0.2).withMargin(2.0f));
         deckFlexbox.items.add(juce::FlexItem(sliderFlexBox).withFlex(2));
         deckFlexbox.items.add(juce::FlexItem(rotatingDeck).withFlex(4).withMargin(2.0f));
         deckFlexbox.items.add(juce::FlexItem(qButtonFlexBox).withFlex(0.75).withMargin(2.0f));
@@ -203,6 +217,7 @@ void DeckGUI::resized()
 
     mainFlexBox.items.add(juce::FlexItem(fileNameLabel).withFlex(0.25));
     mainFlexBox.items.add(juce::FlexItem(fileFlexBox).withFlex(1));
+    mainFlexBox.items.add(juce::FlexItem(zoomedWaveform).withFlex(1).withMargin(2.0f));
     mainFlexBox.items.add(juce::FlexItem(deckFlexbox).withFlex(5));
 
     mainFlexBox.performLayout(getLocalBounds().toFloat());
@@ -241,6 +256,12 @@ void DeckGUI::buttonClicked(Button* button)
             });
     }
 
+    if (button == &cueButton)
+    {
+        if (onCueToggled != nullptr)
+            onCueToggled(cueButton.getToggleState());
+    }
+
     for (int i = 0; i < 5; i++) {
         if (button == &tButton[i]) {
             if (!button->getToggleState()) {
@@ -249,6 +270,7 @@ void DeckGUI::buttonClicked(Button* button)
             else {
                 QPoints[i] = posSlider.getValue();
             }
+            updateCueMarkers();
         }
     }
 
@@ -294,16 +316,16 @@ void DeckGUI::filesDropped(const StringArray& files, int x, int y)
     }
 }
 
-void DeckGUI::timerCallback()
+void DeckGUI::updateAnimation()
 {
     if (!player) return; // Check if player is valid
-    // Get current position and ensure it's within range
-    double currentPosition = jlimit(0.0, 1.0, player->getPositionRelative());
+    // One lock-free read of the audio clock, extrapolated to this frame
+    const auto playhead = player->getPlayheadSnapshot();
+    double currentPosition = playhead.getPositionRelativeAt(Time::getMillisecondCounterHiRes());
 
-    if (player->isPlaying()) {
-        angle += speedSlider.getValue() * 0.05f;
-        angle = fmod(angle, degreesToRadians(360.0));
-    }
+    // Turn the platter like a 33 1/3 rpm record, locked to the track position so it stops when the deck does
+    const double platterRadiansPerSecond = MathConstants<double>::twoPi * (100.0 / 3.0) / 60.0;
+    angle = (float) std::fmod(currentPosition * playhead.lengthSeconds * platterRadiansPerSecond, MathConstants<double>::twoPi);
 
     if (!isnan(currentPosition)) {
         waveformDisplay.setPositionRelative(currentPosition);
@@ -313,7 +335,17 @@ void DeckGUI::timerCallback()
 
 }
 
-bool DeckGUI::loadFile(String filePath)
+void DeckGUI::updateCueMarkers()
+{
+    Array<double> cues;
+    for (int i = 0; i < 5; i++)
+        cues.add(tButton[i].getToggleState() ? QPoints[i] : -1.0);
+
+    waveformDisplay.setCuePoints(cues);
+    zoomedWaveform.setCuePoints(cues);
+}
+
+bool DeckGUI::loadFile(String filePath, float trackGainDb)
 {
 
         currentFilePath = filePath;
@@ -322,8 +354,8 @@ bool DeckGUI::loadFile(String filePath)
         if (file.existsAsFile()) {
             DBG("Loading file: " << file.getFullPathName());
             player->loadURL(URL{ file });
-            waveformDisplay.loadURL(URL{ file });
-            fileNameLabel.setText(file.getFileName(), dontSendNotification); // Update label text
+            player->setTrackGainDecibels(trackGainDb);
+            displayLoadedFile(filePath);
             return true;
         }
         return false;
@@ -331,6 +363,15 @@ bool DeckGUI::loadFile(String filePath)
 
 }
 
+void DeckGUI::displayLoadedFile(String filePath)
+{
+    currentFilePath = filePath;
+    File file{ filePath };
+    waveformDisplay.loadURL(URL{ file });
+    zoomedWaveform.setPyramid(waveformDisplay.getPyramid());
+    fileNameLabel.setText(file.getFileName(), dontSendNotification); // Update label text
+}
+
 void DeckGUI::setmix(float mix)
 {
     if (&volSlider != nullptr) {
@@ -3,19 +3,20 @@
 #include <JuceHeader.h>
 #include "DJAudioPlayer.h"
 #include "WaveformDisplay.h"
+#include "ZoomedWaveformDisplay.h"
 #include "RotatingDeckComponent.h"
 #include "CustomLookAndFeel.h"
+#include "LoudnessMeter.h"
 
 class DeckGUI : public Component,
     public Button::Listener,
     public Slider::Listener,
-    public FileDragAndDropTarget,
-    public Timer
+    public FileDragAndDropTarget
 {
 public:
     DeckGUI(DJAudioPlayer* player,
         AudioFormatManager& formatManagerToUse,
-        AudioThumbnailCache& cacheToUse,
+        WaveformCache& cacheToUse,
         int& playerIndex,
         Colour knobColor = Colours::green,
         Colour ringColor = Colours::black,
@@ -40,20 +41,36 @@ public:
     bool isInterestedInFileDrag(const StringArray& files) override;
     void filesDropped(const StringArray& files, int x, int y) override;
 
-    /** Timer callback to update waveform display and slider position */
-    void timerCallback() override;
+    /** Called on every display refresh to move the playhead, position slider and platter */
+    void updateAnimation();
 
-    /** Load file from a file path string */
-    bool loadFile(String filePath);
+    /** Show the set hot cues on both waveforms */
+    void updateCueMarkers();
+
+    /** The loaded track's waveform summary, or null if nothing is loaded */
+    WaveformPyramid::Ptr getWaveform() const { return waveformDisplay.getPyramid(); }
+
+    /** Load file from a file path string, with an optional loudness normalisation offset */
+    bool loadFile(String filePath, float trackGainDb = 0.0f);
+
+    /** Show a file that something else (e.g. automix) has already loaded into the player */
+    void displayLoadedFile(String filePath);
     void setmix(float mix);
+
+    /** Called when the deck's PFL (headphone cue) button is toggled */
+    std::function<void(bool)> onCueToggled;
 private:
     DJAudioPlayer* player;
     WaveformDisplay waveformDisplay;
+    ZoomedWaveformDisplay zoomedWaveform; // Scrolling close-up around the playhead
     RotatingDeckComponent rotatingDeck;
+    LoudnessMeterComponent loudnessMeter;
+    LevelMeterComponent levelMeter; // Post-fader VU and peak
 
     TextButton playButton{ "Play" };
     TextButton stopButton{ "Stop" };
     TextButton loadButton{ "Load" };
+    TextButton cueButton{ "Cue" }; // PFL: send this deck to the headphones
 
     Slider volSlider;
     Slider speedSlider;
@@ -77,5 +94,8 @@ private:
 
     bool initialLoad = true;
 
+    // Declared last so it can only fire once everything it animates exists
+    VBlankAttachment vblankAttachment{ this, [this] { updateAnimation(); } };
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DeckGUI)
 };
@@ -0,0 +1,246 @@
+#include "FolderWatcher.h"
+#include <set>
+
+#if JUCE_LINUX
+ #include <cerrno>
+ #include <sys/inotify.h>
+ #include <poll.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+FolderWatcher::FolderWatcher()
+    : Thread("Library folder watcher")
+{
+}
+
+FolderWatcher::~FolderWatcher()
+{
+    stop();
+}
+
+void FolderWatcher::watch(const Array<File>& foldersToWatch, const String& fileWildcard, std::map<String, Fingerprint> knownFiles)
+{
+    stop();
+
+    folders = foldersToWatch;
+    wildcard = fileWildcard;
+    snapshot = std::move(knownFiles);
+
+    if (!folders.isEmpty())
+        startThread(Thread::Priority::low);
+}
+
+void FolderWatcher::stop()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread(4000);
+
+    cancelPendingUpdate();
+    const ScopedLock sl(pendingLock);
+    pending.clear();
+}
+
+//==============================================================================
+void FolderWatcher::run()
+{
+    // Catch up with anything that changed while we weren't watching
+    reconcileAll();
+
+    if (watchWithInotify())
+        return;
+
+    while (!threadShouldExit())
+    {
+        wait(pollIntervalMs);
+
+        if (!threadShouldExit())
+            reconcileAll();
+    }
+}
+
+void FolderWatcher::reconcileAll()
+{
+    for (const auto& folder : folders)
+        reconcile(folder, true);
+}
+
+void FolderWatcher::reconcile(const File& directory, bool recursive)
+{
+    std::vector<Change> changes;
+    std::set<String> seen;
+
+    for (const auto& entry : RangedDirectoryIterator(directory, recursive, wildcard, File::findFiles))
+    {
+        if (threadShouldExit())
+            return;
+
+        const String path = entry.getFile().getFullPathName();
+        const Fingerprint current{ entry.getFileSize(), entry.getModificationTime().toMilliseconds() };
+        seen.insert(path);
+
+        auto known = snapshot.find(path);
+        if (known == snapshot.end() || known->second != current)
+        {
+            snapshot[path] = current;
+            changes.push_back({ path, false });
+        }
+    }
+
+    // Whatever we knew of under the directory but didn't just list has gone. Paths under
+    // a directory sort together, so they are one contiguous run of the map
+    const String prefix = directory.getFullPathName() + File::getSeparatorString();
+
+    for (auto it = snapshot.lower_bound(prefix); it != snapshot.end() && it->first.startsWith(prefix);)
+    {
+        const bool inScope = recursive || !it->first.substring(prefix.length()).containsChar(File::getSeparatorChar());
+
+        if (inScope && seen.count(it->first) == 0)
+        {
+            changes.push_back({ it->first, true });
+            it = snapshot.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (changes.empty())
+        return;
+
+    {
+        const ScopedLock sl(pendingLock);
+        pending.insert(pending.end(), changes.begin(), changes.end());
+    }
+
+    triggerAsyncUpdate();
+}
+
+void FolderWatcher::handleAsyncUpdate()
+{
+    std::vector<Change> batch;
+    {
+        const ScopedLock sl(pendingLock);
+        batch.swap(pending);
+    }
+
+    if (!batch.empty() && onChanges != nullptr)
+        onChanges(batch);
+}
+
+//==============================================================================
+bool FolderWatcher::watchWithInotify()
+{
+   #if JUCE_LINUX
+    const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    constexpr uint32_t mask = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE
+                            | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+    std::map<int, File> directoryByWatch;
+    bool outOfWatches = false;
+
+    // inotify isn't recursive, so every directory needs a watch of its own
+    auto addWatches = [&](const File& root)
+    {
+        Array<File> directories{ root };
+        directories.addArray(root.findChildFiles(File::findDirectories, true));
+
+        for (const auto& dir : directories)
+        {
+            const int wd = inotify_add_watch(fd, dir.getFullPathName().toRawUTF8(), mask);
+            if (wd >= 0)
+                directoryByWatch[wd] = dir;
+            else if (errno == ENOSPC) // Hit fs.inotify.max_user_watches
+                outOfWatches = true;
+        }
+    };
+
+    for (const auto& folder : folders)
+        addWatches(folder);
+
+    std::map<String, bool> dirty; // Directory path -> whether its subdirectories need listing too
+    uint32 lastEventMs = 0;
+    alignas(inotify_event) char buffer[16384];
+
+    while (!threadShouldExit() && !outOfWatches)
+    {
+        pollfd request{ fd, POLLIN, 0 };
+
+        if (poll(&request, 1, 250) > 0)
+        {
+            ssize_t numRead;
+            while ((numRead = read(fd, buffer, sizeof(buffer))) > 0)
+            {
+                for (char* p = buffer; p < buffer + numRead;)
+                {
+                    const auto* event = reinterpret_cast<const inotify_event*>(p);
+                    p += sizeof(inotify_event) + event->len;
+
+                    if ((event->mask & IN_Q_OVERFLOW) != 0)
+                    {
+                        // Events were lost, so only a full walk can tell what happened
+                        for (const auto& folder : folders)
+                            dirty[folder.getFullPathName()] = true;
+                        continue;
+                    }
+
+                    auto watched = directoryByWatch.find(event->wd);
+                    if (watched == directoryByWatch.end())
+                        continue;
+
+                    const File dir = watched->second;
+
+                    if ((event->mask & (IN_IGNORED | IN_MOVE_SELF | IN_DELETE_SELF)) != 0)
+                    {
+                        // The parent's event covers the files; paths under a moved watch would be wrong
+                        inotify_rm_watch(fd, event->wd);
+                        directoryByWatch.erase(watched);
+                        continue;
+                    }
+
+                    if (event->len == 0)
+                        continue;
+
+                    const File child = dir.getChildFile(String::fromUTF8(event->name));
+
+                    if ((event->mask & IN_ISDIR) != 0)
+                    {
+                        // A directory arrived or left: its whole subtree needs diffing
+                        if ((event->mask & (IN_CREATE | IN_MOVED_TO)) != 0)
+                            addWatches(child);
+
+                        dirty[child.getFullPathName()] = true;
+                    }
+                    else
+                    {
+                        dirty.emplace(dir.getFullPathName(), false);
+                    }
+                }
+            }
+
+            lastEventMs = Time::getMillisecondCounter();
+        }
+
+        // Copying a file produces a stream of events; diff once it has gone quiet
+        if (!dirty.empty() && Time::getMillisecondCounter() - lastEventMs >= (uint32) settleMs)
+        {
+            for (const auto& entry : dirty)
+                reconcile(File(entry.first), entry.second);
+
+            dirty.clear();
+        }
+    }
+
+    close(fd);
+
+    // Out of watches: the caller falls back to walking the folders periodically
+    return !outOfWatches;
+   #else
+    return false;
+   #endif
+}
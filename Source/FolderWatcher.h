@@ -0,0 +1,76 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <map>
+#include <vector>
+
+//==============================================================================
+/**
+ * Watches the library folders and reports audio files that appear, change or
+ * disappear, so only those files need to be scanned again.
+ *
+ * The watcher keeps a fingerprint (size and modification time) of every file
+ * under its folders, seeded from what the library already knows. On start it
+ * walks the folders once to catch changes made while the app was closed. On
+ * Linux it then sleeps on inotify and re-lists only the directories an event
+ * touched, once the burst of events from a copy has settled. Elsewhere, or
+ * if inotify runs out of watches, it walks the folders every few minutes and
+ * diffs the fingerprints instead.
+ */
+class FolderWatcher : private Thread,
+                      private AsyncUpdater
+{
+public:
+    struct Fingerprint
+    {
+        int64 size = 0;
+        int64 modificationTime = 0;
+
+        bool operator==(const Fingerprint& other) const { return size == other.size && modificationTime == other.modificationTime; }
+        bool operator!=(const Fingerprint& other) const { return !operator==(other); }
+    };
+
+    struct Change
+    {
+        String filePath;
+        bool removed = false; // Otherwise the file is new or has been modified
+    };
+
+    FolderWatcher();
+    ~FolderWatcher() override;
+
+    /**
+     * Start (or restart) watching. fileWildcard picks the files of interest, e.g.
+     * "*.wav;*.mp3", and knownFiles holds the fingerprints the library has on record.
+     */
+    void watch(const Array<File>& folders, const String& fileWildcard, std::map<String, Fingerprint> knownFiles);
+
+    /** Stop watching; no more changes will be reported. */
+    void stop();
+
+    /** Called on the message thread with each batch of changes. */
+    std::function<void(const std::vector<Change>&)> onChanges;
+
+    static constexpr int pollIntervalMs = 5 * 60 * 1000; // Fallback walk when there are no change notifications
+    static constexpr int settleMs = 1000;                 // Quiet time after the last event before diffing
+
+private:
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    /** Diff a directory against the fingerprints and report what differs. */
+    void reconcile(const File& directory, bool recursive);
+    void reconcileAll();
+
+    /** Sleep on inotify until told to exit. Returns false if inotify isn't available. */
+    bool watchWithInotify();
+
+    Array<File> folders;                   // Set before the thread starts
+    String wildcard;
+    std::map<String, Fingerprint> snapshot; // Watcher thread only while it runs
+
+    CriticalSection pendingLock;
+    std::vector<Change> pending; // Guarded by pendingLock
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FolderWatcher)
+};
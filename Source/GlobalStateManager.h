@@ -38,6 +38,32 @@ public:
         currentFile = prefs->getValue(playerPrefix + "currentFile", String()); // Load the current playing file
     }
 
+    // Read an application-wide option, e.g. "parallelDecks"
+    bool getBoolSetting(const String& key, bool defaultValue)
+    {
+        return prefs->getBoolValue(key, defaultValue);
+    }
+
+    // Save an application-wide option
+    void setBoolSetting(const String& key, bool value)
+    {
+        prefs->setValue(key, value);
+        prefs->saveIfNeeded();
+    }
+
+    // Read an application-wide text option, e.g. "libraryFolders"
+    String getStringSetting(const String& key, const String& defaultValue = {})
+    {
+        return prefs->getValue(key, defaultValue);
+    }
+
+    // Save an application-wide text option
+    void setStringSetting(const String& key, const String& value)
+    {
+        prefs->setValue(key, value);
+        prefs->saveIfNeeded();
+    }
+
 private:
     GlobalStateManager()
     {
@@ -0,0 +1,240 @@
+#include "LevelMeter.h"
+#include "PaintProfiler.h"
+
+//==============================================================================
+void MeterTap::prepare(double newSampleRate)
+{
+    sampleRate.store(newSampleRate, std::memory_order_relaxed);
+    hasPendingSample = false;
+}
+
+void MeterTap::process(const AudioSourceChannelInfo& block)
+{
+    const auto& buffer = *block.buffer;
+    const int numChannels = jmin(2, buffer.getNumChannels());
+    const int numSamples = block.numSamples;
+
+    if (numChannels == 0 || numSamples <= 0)
+        return;
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        const int source = jmin(ch, numChannels - 1); // Mono sources show on both bars
+        const auto range = FloatVectorOperations::findMinAndMax(buffer.getReadPointer(source, block.startSample), numSamples);
+        const float blockPeak = jmax(std::abs(range.getStart()), std::abs(range.getEnd()));
+
+        // Keep the highest peak until the GUI collects it
+        float current = peaks[ch].load(std::memory_order_relaxed);
+        while (blockPeak > current && !peaks[ch].compare_exchange_weak(current, blockPeak, std::memory_order_relaxed))
+        {
+        }
+
+        rms[ch].store(buffer.getRMSLevel(source, block.startSample, numSamples), std::memory_order_relaxed);
+    }
+
+    // Nothing drains the FIFO without a spectrum view, so don't fill it
+    if (!spectrumEnabled.load(std::memory_order_relaxed))
+    {
+        hasPendingSample = false;
+        return;
+    }
+
+    // Mono sum, averaged in pairs: a cheap anti-alias filter ahead of the 2x decimation
+    const float* left = buffer.getReadPointer(0, block.startSample);
+    const float* right = buffer.getReadPointer(numChannels - 1, block.startSample);
+    auto mono = [left, right](int i) { return 0.5f * (left[i] + right[i]); };
+
+    const int numOutput = (numSamples + (hasPendingSample ? 1 : 0)) / decimationFactor;
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numOutput, start1, size1, start2, size2);
+
+    int input = 0;
+    auto nextOutput = [&]()
+    {
+        const float first = hasPendingSample ? pendingSample : mono(input++);
+        hasPendingSample = false;
+        return 0.5f * (first + mono(input++));
+    };
+
+    for (int i = 0; i < size1; ++i)
+        fifoData[(size_t) (start1 + i)] = nextOutput();
+    for (int i = 0; i < size2; ++i)
+        fifoData[(size_t) (start2 + i)] = nextOutput();
+
+    fifo.finishedWrite(size1 + size2);
+
+    // If the FIFO was full the rest of the block is dropped, otherwise carry an odd sample over
+    hasPendingSample = size1 + size2 == numOutput && input < numSamples;
+    if (hasPendingSample)
+        pendingSample = mono(numSamples - 1);
+}
+
+float MeterTap::takePeak(int channel)
+{
+    return peaks[jlimit(0, 1, channel)].exchange(0.0f, std::memory_order_relaxed);
+}
+
+int MeterTap::readSamples(float* destination, int maxSamples)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(maxSamples, start1, size1, start2, size2);
+
+    if (size1 > 0)
+        FloatVectorOperations::copy(destination, fifoData.data() + start1, size1);
+    if (size2 > 0)
+        FloatVectorOperations::copy(destination + size1, fifoData.data() + start2, size2);
+
+    fifo.finishedRead(size1 + size2);
+    return size1 + size2;
+}
+
+//==============================================================================
+LevelMeterComponent::LevelMeterComponent(MeterTap& tapToShow, Colour colour)
+    : tap(tapToShow), barColour(colour)
+{
+    setOpaque(true);
+}
+
+void LevelMeterComponent::updateLevels()
+{
+    const double now = Time::getMillisecondCounterHiRes();
+    const float elapsed = lastFrameMs > 0.0 ? (float) jmin(0.1, (now - lastFrameMs) * 0.001) : 0.0f;
+    lastFrameMs = now;
+
+    // VU integration time is about 300 ms; peak hold falls back at 20 dB per second
+    const float vuCoefficient = 1.0f - std::exp(-elapsed / 0.3f);
+    const float peakFall = Decibels::decibelsToGain(-20.0f * elapsed);
+    bool changed = false;
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        const float newVu = vuLevel[ch] + (tap.getRms(ch) - vuLevel[ch]) * vuCoefficient;
+        const float newPeak = jmax(tap.takePeak(ch), peakHold[ch] * peakFall);
+
+        changed = changed || std::abs(newVu - vuLevel[ch]) > 1.0e-4f || std::abs(newPeak - peakHold[ch]) > 1.0e-4f;
+        vuLevel[ch] = newVu;
+        peakHold[ch] = newPeak;
+    }
+
+    if (changed)
+        repaint();
+}
+
+void LevelMeterComponent::paint(Graphics& g)
+{
+    OTODECKS_PROFILE_PAINT("LevelMeterComponent::paint");
+    g.fillAll(Colours::black);
+
+    auto bounds = getLocalBounds().toFloat().reduced(1.0f);
+    const float barWidth = bounds.getWidth() * 0.5f;
+
+    auto toY = [&bounds](float gain)
+    {
+        const float db = jlimit(minDb, maxDb, Decibels::gainToDecibels(gain, minDb));
+        return jmap(db, minDb, maxDb, bounds.getBottom(), bounds.getY());
+    };
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        auto bar = bounds.withX(bounds.getX() + barWidth * ch).withWidth(barWidth - 1.0f);
+
+        g.setColour(vuLevel[ch] > 1.0f ? Colours::red : barColour);
+        g.fillRect(bar.withTop(toY(vuLevel[ch])));
+
+        g.setColour(peakHold[ch] >= 1.0f ? Colours::red : Colours::white);
+        g.fillRect(bar.withTop(toY(peakHold[ch])).withHeight(2.0f));
+    }
+
+    // 0 dBFS reference
+    g.setColour(Colours::white.withAlpha(0.4f));
+    g.drawHorizontalLine(roundToInt(toY(1.0f)), bounds.getX(), bounds.getRight());
+}
+
+//==============================================================================
+SpectrumComponent::SpectrumComponent(MeterTap& tapToShow, Colour colour)
+    : tap(tapToShow), barColour(colour)
+{
+    setOpaque(true);
+    std::fill(std::begin(bars), std::end(bars), minDb);
+    tap.setSpectrumEnabled(true);
+}
+
+SpectrumComponent::~SpectrumComponent()
+{
+    tap.setSpectrumEnabled(false);
+}
+
+void SpectrumComponent::mouseDown(const MouseEvent&)
+{
+    analyserOn = !analyserOn;
+    std::fill(std::begin(bars), std::end(bars), minDb);
+    repaint();
+}
+
+void SpectrumComponent::updateSpectrum()
+{
+    // Keep draining while hidden or switched off so the view doesn't open on stale audio
+    const int numNew = tap.readSamples(incoming.data(), (int) incoming.size());
+
+    if (!analyserOn || !isShowing() || numNew == 0)
+        return;
+
+    // Slide the newest samples into the analysis window
+    const int keep = jmax(0, fftSize - numNew);
+    const int take = jmin(numNew, fftSize);
+    std::memmove(history.data(), history.data() + (fftSize - keep), sizeof(float) * (size_t) keep);
+    std::memcpy(history.data() + keep, incoming.data() + (numNew - take), sizeof(float) * (size_t) take);
+
+    std::copy(history.begin(), history.end(), fftData.begin());
+    window.multiplyWithWindowingTable(fftData.data(), (size_t) fftSize);
+    fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+    // Bands spaced logarithmically from 30 Hz to Nyquist; each bar shows the loudest bin it covers
+    const double binHz = tap.getDecimatedSampleRate() / fftSize;
+    const double nyquist = tap.getDecimatedSampleRate() * 0.5;
+
+    for (int bar = 0; bar < numBars; ++bar)
+    {
+        const double lowHz = 30.0 * std::pow(nyquist / 30.0, (double) bar / numBars);
+        const double highHz = 30.0 * std::pow(nyquist / 30.0, (double) (bar + 1) / numBars);
+        const int firstBin = jlimit(1, fftSize / 2 - 1, (int) (lowHz / binHz));
+        const int lastBin = jlimit(firstBin + 1, fftSize / 2, (int) (highHz / binHz) + 1);
+
+        const float magnitude = FloatVectorOperations::findMaximum(fftData.data() + firstBin, lastBin - firstBin);
+        const float db = Decibels::gainToDecibels(magnitude * 4.0f / fftSize, minDb);
+
+        // Fast attack, slow release
+        bars[bar] = db > bars[bar] ? db : jmax(db, bars[bar] - 1.5f);
+    }
+
+    repaint();
+}
+
+void SpectrumComponent::paint(Graphics& g)
+{
+    OTODECKS_PROFILE_PAINT("SpectrumComponent::paint");
+    g.fillAll(Colours::black);
+
+    if (!analyserOn)
+    {
+        g.setColour(Colours::grey);
+        g.setFont(10.0f);
+        g.drawText("Spectrum off", getLocalBounds(), Justification::centred, false);
+        return;
+    }
+
+    const auto bounds = getLocalBounds().toFloat();
+    const float barWidth = bounds.getWidth() / numBars;
+
+    RectangleList<float> rects;
+    rects.ensureStorageAllocated(numBars);
+
+    for (int bar = 0; bar < numBars; ++bar)
+    {
+        const float top = jmap(bars[bar], minDb, 0.0f, bounds.getBottom(), bounds.getY());
+        rects.addWithoutMerging({ bounds.getX() + bar * barWidth, top, jmax(1.0f, barWidth - 1.0f), bounds.getBottom() - top });
+    }
+
+    g.setColour(barColour);
+    g.fillRectList(rects);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+#include <vector>
+
+//==============================================================================
+/**
+ * Audio-thread tap that feeds the GUI meters.
+ *
+ * process() records each block's peak and RMS in atomics and, while a
+ * spectrum view is attached, pushes a mono, 2x decimated copy of the signal
+ * into a single-producer/single-consumer AbstractFifo for it. It never blocks
+ * or allocates: if the GUI falls behind and the FIFO fills up, the surplus
+ * samples are simply dropped.
+ */
+class MeterTap
+{
+public:
+    static constexpr int decimationFactor = 2;
+    static constexpr int fifoSize = 16384;
+
+    void prepare(double sampleRate);
+
+    /** Audio thread: measure (without modifying) the active region of the block. */
+    void process(const AudioSourceChannelInfo& block);
+
+    //==============================================================================
+    /** GUI thread: highest absolute sample on the channel since the previous call. */
+    float takePeak(int channel);
+
+    /** GUI thread: RMS of the channel over the most recent block. */
+    float getRms(int channel) const { return rms[jlimit(0, 1, channel)].load(std::memory_order_relaxed); }
+
+    /** Feed the FIFO only while something reads it; taps without a spectrum view skip that work. */
+    void setSpectrumEnabled(bool shouldBeEnabled) { spectrumEnabled.store(shouldBeEnabled, std::memory_order_relaxed); }
+
+    /** GUI thread (one reader only): pull up to maxSamples decimated mono samples, returning how many were read. */
+    int readSamples(float* destination, int maxSamples);
+
+    /** Rate of the samples returned by readSamples() */
+    double getDecimatedSampleRate() const { return sampleRate.load(std::memory_order_relaxed) / decimationFactor; }
+
+private:
+    AbstractFifo fifo{ fifoSize };
+    std::vector<float> fifoData = std::vector<float>((size_t) fifoSize);
+
+    std::atomic<float> peaks[2] = { { 0.0f }, { 0.0f } };
+    std::atomic<float> rms[2] = { { 0.0f }, { 0.0f } };
+    std::atomic<double> sampleRate{ 44100.0 };
+    std::atomic<bool> spectrumEnabled{ false }; // Set by the SpectrumComponent reading the FIFO
+
+    // Audio thread only: a sample left over from an odd-length block, paired up at the start of the next
+    float pendingSample = 0.0f;
+    bool hasPendingSample = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MeterTap)
+};
+
+//==============================================================================
+/** Stereo VU bars with peak-hold lines, redrawn on display refresh. */
+class LevelMeterComponent : public Component
+{
+public:
+    LevelMeterComponent(MeterTap& tapToShow, Colour barColour = Colours::springgreen);
+
+    void paint(Graphics& g) override;
+
+private:
+    void updateLevels();
+
+    static constexpr float minDb = -60.0f;
+    static constexpr float maxDb = 3.0f;
+
+    MeterTap& tap;
+    Colour barColour;
+
+    float vuLevel[2] = {};     // RMS with VU-style (300 ms) ballistics
+    float peakHold[2] = {};    // Decaying peak-hold level
+    double lastFrameMs = 0.0;
+
+    VBlankAttachment vblankAttachment{ this, [this] { updateLevels(); } };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LevelMeterComponent)
+};
+
+//==============================================================================
+/**
+ * Log-frequency spectrum of a MeterTap. The FFT runs here on the message thread,
+ * at most once per display frame and only while the view is showing.
+ */
+class SpectrumComponent : public Component
+{
+public:
+    SpectrumComponent(MeterTap& tapToShow, Colour barColour = Colours::springgreen);
+    ~SpectrumComponent() override;
+
+    void paint(Graphics& g) override;
+
+    /** Click to switch the analyser on or off */
+    void mouseDown(const MouseEvent&) override;
+
+private:
+    void updateSpectrum();
+
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int numBars = 48;
+    static constexpr float minDb = -90.0f;
+
+    MeterTap& tap;
+    Colour barColour;
+    bool analyserOn = true;
+
+    dsp::FFT fft{ fftOrder };
+    dsp::WindowingFunction<float> window{ (size_t) fftSize, dsp::WindowingFunction<float>::hann };
+    std::vector<float> history = std::vector<float>((size_t) fftSize); // Most recent samples, oldest first
+    std::vector<float> fftData = std::vector<float>((size_t) fftSize * 2);
+    std::vector<float> incoming = std::vector<float>((size_t) MeterTap::fifoSize);
+    float bars[numBars] = {}; // Smoothed level of each band, in dB
+
+    VBlankAttachment vblankAttachment{ this, [this] { updateSpectrum(); } };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumComponent)
+};
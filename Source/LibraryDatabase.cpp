@@ -0,0 +1,326 @@
+#include "LibraryDatabase.h"
+
+namespace
+{
+    constexpr uint32 fileMagic = 0x424c544f; // "OTLB"
+    constexpr uint32 formatVersion = 1;
+    constexpr size_t fileHeaderSize = 8;     // Magic, version
+    constexpr size_t recordHeaderSize = 9;   // Payload size, type, checksum
+
+    /** 32-bit FNV-1a over a record's payload */
+    uint32 checksum(const void* data, size_t numBytes)
+    {
+        const auto* bytes = static_cast<const uint8*>(data);
+        uint32 hash = 0x811c9dc5u;
+
+        for (size_t i = 0; i < numBytes; ++i)
+            hash = (hash ^ bytes[i]) * 0x01000193u;
+
+        return hash;
+    }
+
+    void writeTrack(OutputStream& out, const LibraryDatabase::Track& t)
+    {
+        out.writeString(t.filePath);
+        out.writeString(t.title);
+        out.writeString(t.artist);
+        out.writeString(t.album);
+        out.writeString(t.genre);
+        out.writeString(t.key);
+        out.writeDouble(t.bpm);
+        out.writeDouble(t.lengthSeconds);
+        out.writeFloat(t.loudness);
+        out.writeFloat(t.truePeak);
+        out.writeBool(t.hasLoudness);
+        out.writeBool(t.scanned);
+        out.writeInt64(t.fileSize);
+        out.writeInt64(t.modificationTime);
+    }
+
+    LibraryDatabase::Track readTrack(InputStream& in)
+    {
+        LibraryDatabase::Track t;
+        t.filePath = in.readString();
+        t.title = in.readString();
+        t.artist = in.readString();
+        t.album = in.readString();
+        t.genre = in.readString();
+        t.key = in.readString();
+        t.bpm = in.readDouble();
+        t.lengthSeconds = in.readDouble();
+        t.loudness = in.readFloat();
+        t.truePeak = in.readFloat();
+        t.hasLoudness = in.readBool();
+        t.scanned = in.readBool();
+        t.fileSize = in.readInt64();
+        t.modificationTime = in.readInt64();
+        return t;
+    }
+
+    void writeRecord(OutputStream& out, uint8 type, const MemoryOutputStream& payload)
+    {
+        out.writeInt((int) payload.getDataSize());
+        out.writeByte((char) type);
+        out.writeInt((int) checksum(payload.getData(), payload.getDataSize()));
+        out.write(payload.getData(), payload.getDataSize());
+    }
+}
+
+//==============================================================================
+LibraryDatabase::LibraryDatabase(const File& f, bool importLegacyFileList)
+    : file(f), importLegacy(importLegacyFileList)
+{
+    file.getParentDirectory().createDirectory();
+}
+
+LibraryDatabase::~LibraryDatabase()
+{
+    flush();
+}
+
+File LibraryDatabase::getDefaultFile()
+{
+    return File::getSpecialLocation(File::SpecialLocationType::userApplicationDataDirectory)
+        .getChildFile(ProjectInfo::projectName)
+        .getChildFile("Library.db");
+}
+
+File LibraryDatabase::getLegacyFileList()
+{
+    return File::getSpecialLocation(File::userDocumentsDirectory).getChildFile("MusicLibraryFileList.txt");
+}
+
+//==============================================================================
+std::vector<LibraryDatabase::Track> LibraryDatabase::open()
+{
+    std::vector<Track> tracks;
+    log.reset();
+
+    if (!file.existsAsFile())
+    {
+        // First run with the database: pick up the old plain-text path list, to be scanned in the background
+        const File legacy = getLegacyFileList();
+        StringArray paths;
+        if (importLegacy && legacy.existsAsFile())
+            paths.addLines(legacy.loadFileAsString());
+
+        for (const auto& path : paths)
+        {
+            const File musicFile(path);
+            if (path.isNotEmpty() && musicFile.existsAsFile())
+            {
+                Track t;
+                t.filePath = path;
+                t.title = musicFile.getFileNameWithoutExtension();
+                tracks.push_back(t);
+            }
+        }
+
+        // Appending to a file with no header would leave it unreadable next time
+        if (rewrite(tracks))
+            openLogForAppend();
+        else
+            Logger::writeToLog("Library: could not create " + file.getFullPathName() + "; changes won't be saved this session");
+
+        return tracks;
+    }
+
+    size_t validEnd = 0, fileSize = 0;
+    int numRecords = 0;
+    bool mappedOk, headerOk;
+    {
+        MemoryMappedFile mapped(file, MemoryMappedFile::readOnly);
+        const auto* data = static_cast<const uint8*>(mapped.getData());
+        fileSize = mapped.getSize();
+
+        HashMap<String, int> indexByPath;
+        std::vector<bool> removed;
+
+        mappedOk = data != nullptr;
+        headerOk = mappedOk && fileSize >= fileHeaderSize
+            && ByteOrder::littleEndianInt(data) == fileMagic
+            && ByteOrder::littleEndianInt(data + 4) == formatVersion;
+
+        size_t pos = headerOk ? fileHeaderSize : 0;
+
+        while (headerOk && pos + recordHeaderSize <= fileSize)
+        {
+            const uint32 payloadSize = ByteOrder::littleEndianInt(data + pos);
+            const uint8 type = data[pos + 4];
+            const uint32 expectedChecksum = ByteOrder::littleEndianInt(data + pos + 5);
+            const uint8* payload = data + pos + recordHeaderSize;
+
+            // Stop at a record cut short by a crash, or one that doesn't check out
+            if (payloadSize > fileSize - pos - recordHeaderSize || checksum(payload, payloadSize) != expectedChecksum)
+                break;
+
+            MemoryInputStream in(payload, payloadSize, false);
+
+            if (type == storeRecord)
+            {
+                Track t = readTrack(in);
+
+                if (indexByPath.contains(t.filePath))
+                {
+                    tracks[(size_t) indexByPath[t.filePath]] = std::move(t);
+                }
+                else
+                {
+                    indexByPath.set(t.filePath, (int) tracks.size());
+                    tracks.push_back(std::move(t));
+                    removed.push_back(false);
+                }
+            }
+            else if (type == removeRecord)
+            {
+                const String path = in.readString();
+
+                if (indexByPath.contains(path))
+                {
+                    removed[(size_t) indexByPath[path]] = true;
+                    indexByPath.remove(path);
+                }
+            }
+            else if (type == clearRecord)
+            {
+                tracks.clear();
+                removed.clear();
+                indexByPath.clear();
+            }
+
+            ++numRecords;
+            pos += recordHeaderSize + payloadSize;
+        }
+
+        validEnd = pos;
+
+        // Drop removed tracks, keeping the order of the rest
+        size_t kept = 0;
+        for (size_t i = 0; i < tracks.size(); ++i)
+            if (!removed[i])
+                tracks[kept++] = std::move(tracks[i]);
+
+        tracks.resize(kept);
+    }
+
+    if (!mappedOk && file.getSize() > 0)
+    {
+        // Couldn't read it at all, e.g. another process has it locked. Leave it untouched, and
+        // keep this session's changes out of it rather than append to a log we haven't replayed
+        Logger::writeToLog("Library: could not open " + file.getFullPathName() + "; changes won't be saved this session");
+        return tracks;
+    }
+
+    if (mappedOk && !headerOk)
+    {
+        // Not a database this version can read, perhaps from a newer one: set it aside and start afresh
+        const File backup = file.getSiblingFile(file.getFileName() + ".bak");
+        const File target = backup.exists() ? backup.getNonexistentSibling() : backup;
+
+        if (!file.moveFileTo(target))
+        {
+            Logger::writeToLog("Library: " + file.getFullPathName() + " is unreadable and could not be moved aside; changes won't be saved this session");
+            return tracks;
+        }
+
+        Logger::writeToLog("Library: moved unreadable " + file.getFileName() + " aside to " + target.getFileName());
+    }
+
+    // Rewrite if there's no valid header yet (an empty or moved-aside file), if a torn tail has to be
+    // cut off the end of the log, or if most of the log has been superseded
+    const bool mustRewrite = !headerOk || validEnd != fileSize;
+
+    if ((mustRewrite || numRecords > 2 * (int) tracks.size() + 64) && !rewrite(tracks) && mustRewrite)
+    {
+        // Records appended after a torn tail would never be replayed, and a file without a header
+        // wouldn't be read at all, so this session's changes would be lost without a word
+        Logger::writeToLog("Library: could not repair " + file.getFullPathName() + "; changes won't be saved this session");
+        return tracks;
+    }
+
+    openLogForAppend();
+    return tracks;
+}
+
+void LibraryDatabase::store(const Track& track)
+{
+    MemoryOutputStream payload;
+    writeTrack(payload, track);
+    appendRecord(storeRecord, payload);
+}
+
+void LibraryDatabase::remove(const String& filePath)
+{
+    MemoryOutputStream payload;
+    payload.writeString(filePath);
+    appendRecord(removeRecord, payload);
+}
+
+void LibraryDatabase::clear()
+{
+    if (log == nullptr)
+        return; // Not saving this session; leave the file alone
+
+    // Nothing in the old log is worth keeping, so start a new one rather than appending a clear record
+    log.reset();
+    const bool replaced = rewrite({});
+
+    // If it couldn't be replaced, the old log is still whole: record the clear at its end instead
+    if (openLogForAppend() && !replaced)
+        appendRecord(clearRecord, MemoryOutputStream());
+}
+
+void LibraryDatabase::flush()
+{
+    if (log != nullptr)
+        log->flush();
+}
+
+//==============================================================================
+void LibraryDatabase::appendRecord(RecordType type, const MemoryOutputStream& payload)
+{
+    if (log != nullptr)
+        writeRecord(*log, type, payload);
+}
+
+bool LibraryDatabase::rewrite(const std::vector<Track>& tracks)
+{
+    // Write beside the database and swap it in, so a crash part-way through leaves the old one intact
+    TemporaryFile temp(file);
+    {
+        FileOutputStream out(temp.getFile());
+
+        if (!out.openedOk())
+            return false;
+
+        out.writeInt((int) fileMagic);
+        out.writeInt((int) formatVersion);
+
+        for (const auto& t : tracks)
+        {
+            MemoryOutputStream payload;
+            writeTrack(payload, t);
+            writeRecord(out, storeRecord, payload);
+        }
+
+        out.flush();
+        if (out.getStatus().failed())
+            return false;
+    }
+
+    return temp.overwriteTargetFileWithTemporary();
+}
+
+bool LibraryDatabase::openLogForAppend()
+{
+    // FileOutputStream opens existing files at their end
+    log = std::make_unique<FileOutputStream>(file);
+
+    if (!log->openedOk())
+    {
+        log.reset();
+        return false;
+    }
+
+    return true;
+}
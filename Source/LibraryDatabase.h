@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <vector>
+
+//==============================================================================
+/**
+ * The library's on-disk store: every track's metadata and analysis results, so
+ * known files never have to be opened again at startup.
+ *
+ * The file is an append-only log of records (store a track, remove a path, or
+ * clear everything), each with a length and checksum. Opening maps the file and
+ * replays the log once; every later change appends a single record. A torn
+ * record at the end, left by a crash mid-write, is dropped. When more than half
+ * the records have been superseded, the log is rewritten compactly on open.
+ *
+ * A file whose header isn't recognised is moved aside with a .bak suffix rather
+ * than overwritten, and one that can't be read at all is left alone.
+ */
+class LibraryDatabase
+{
+public:
+    struct Track
+    {
+        String filePath;
+        String title;
+        String artist;
+        String album;
+        String genre;
+        String key;
+        double bpm = 0.0;
+        double lengthSeconds = -1.0; // Negative if the file couldn't be decoded
+        float loudness = 0.0f;       // Integrated loudness in LUFS
+        float truePeak = 0.0f;       // True peak in dBTP
+        bool hasLoudness = false;
+        bool scanned = false;        // False for files added but not yet read by the scanner
+        int64 fileSize = 0;          // Size and modification time when scanned, to spot changed files
+        int64 modificationTime = 0;
+    };
+
+    explicit LibraryDatabase(const File& file = getDefaultFile(), bool importLegacyFileList = true);
+    ~LibraryDatabase();
+
+    /**
+     * Map the database and return its tracks in the order they were first added.
+     * If there is no database yet, the paths in the old MusicLibraryFileList.txt
+     * are imported as unscanned tracks, unless that was turned off on construction.
+     */
+    std::vector<Track> open();
+
+    /** Add or update a track, keyed by path. */
+    void store(const Track& track);
+
+    /** Forget a track. */
+    void remove(const String& filePath);
+
+    /** Forget every track. */
+    void clear();
+
+    /** Push appended records to disk; call after a batch of changes. */
+    void flush();
+
+    static File getDefaultFile();
+    static File getLegacyFileList();
+
+private:
+    enum RecordType : uint8 { storeRecord = 1, removeRecord = 2, clearRecord = 3 };
+
+    void appendRecord(RecordType type, const MemoryOutputStream& payload);
+    bool rewrite(const std::vector<Track>& tracks); // False if the file was left as it was
+    bool openLogForAppend();
+
+    const File file;
+    const bool importLegacy; // Seed a new database from getLegacyFileList()
+    std::unique_ptr<FileOutputStream> log; // Open for appending after open()
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LibraryDatabase)
+};
@@ -0,0 +1,133 @@
+#include "LibraryImporter.h"
+
+//==============================================================================
+LibraryImporter::LibraryImporter(AudioFormatManager& fm)
+    : Thread("Library import"), formatManager(fm)
+{
+}
+
+LibraryImporter::~LibraryImporter()
+{
+    cancel();
+}
+
+void LibraryImporter::cancel()
+{
+    signalThreadShouldExit();
+    stopThread(4000);
+    cancelPendingUpdate();
+
+    const ScopedLock sl(lock);
+    queuedPaths.clear();
+    pending.clear();
+    batch.clear();
+    finished = false;
+    importing = false;
+}
+
+bool LibraryImporter::canImport(const File& file) const
+{
+    return file.isDirectory() || formatManager.findFormatForFileExtension(file.getFileExtension()) != nullptr;
+}
+
+void LibraryImporter::import(const StringArray& paths)
+{
+    bool startWalk;
+    {
+        const ScopedLock sl(lock);
+        queuedPaths.addArray(paths);
+        startWalk = !importing.exchange(true); // Otherwise the running walk picks them up
+    }
+
+    if (startWalk)
+    {
+        stopThread(4000); // The last walk may still be on its way out
+
+        // The formats are registered by now, which they aren't when we're constructed
+        wildcard = formatManager.getWildcardForAllFormats();
+        seen.clear();
+        startThread(Thread::Priority::low);
+    }
+}
+
+//==============================================================================
+void LibraryImporter::run()
+{
+    while (!threadShouldExit())
+    {
+        String path;
+        {
+            const ScopedLock sl(lock);
+
+            if (queuedPaths.isEmpty())
+            {
+                // Hand over the last partial batch along with the end of the walk, under the same lock
+                // as import(), so a drop arriving now either joins this walk or starts the next
+                pending.insert(pending.end(), batch.begin(), batch.end());
+                batch.clear();
+                finished = true;
+                importing = false;
+                break;
+            }
+
+            path = queuedPaths[0];
+            queuedPaths.remove(0);
+        }
+
+        const File item(path);
+
+        if (item.isDirectory())
+        {
+            for (const auto& entry : RangedDirectoryIterator(item, true, wildcard, File::findFiles))
+            {
+                if (threadShouldExit())
+                    return;
+
+                addFile(entry.getFile());
+            }
+        }
+        else if (item.existsAsFile() && canImport(item))
+        {
+            addFile(item);
+        }
+    }
+
+    triggerAsyncUpdate();
+}
+
+void LibraryImporter::addFile(const File& file)
+{
+    if (!seen.insert(file.getFullPathName()).second)
+        return; // Dropped twice, or inside a folder that was dropped too
+
+    batch.push_back(file);
+
+    if ((int) batch.size() >= batchSize)
+    {
+        {
+            const ScopedLock sl(lock);
+            pending.insert(pending.end(), batch.begin(), batch.end());
+        }
+
+        batch.clear();
+        triggerAsyncUpdate();
+    }
+}
+
+void LibraryImporter::handleAsyncUpdate()
+{
+    std::vector<File> files;
+    bool walkFinished;
+    {
+        const ScopedLock sl(lock);
+        files.swap(pending);
+        walkFinished = finished;
+        finished = false;
+    }
+
+    if (!files.empty() && onFiles != nullptr)
+        onFiles(files);
+
+    if (walkFinished && onFinished != nullptr)
+        onFinished();
+}
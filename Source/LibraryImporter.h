@@ -0,0 +1,63 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <set>
+#include <vector>
+
+//==============================================================================
+/**
+ * Expands files and folders dropped on the library into the audio files to
+ * add. Folders are walked recursively on a background thread. Only files with
+ * an extension the format manager can read are kept. Each file is reported
+ * once, however many times the dropped items overlap.
+ *
+ * Files are handed to the message thread in batches as the walk goes, so
+ * scanning can start before a large folder has been fully listed.
+ */
+class LibraryImporter : private Thread,
+                        private AsyncUpdater
+{
+public:
+    explicit LibraryImporter(AudioFormatManager& formatManager);
+    ~LibraryImporter() override;
+
+    /** Add dropped paths to the walk. Paths dropped while a walk is running join it. */
+    void import(const StringArray& paths);
+
+    /** Stop walking and forget any files not yet handed over. */
+    void cancel();
+
+    /** True until every dropped path has been walked and its files handed over. */
+    bool isImporting() const { return importing.load(); }
+
+    /** Whether a dropped item is worth accepting: a folder, or a file of a readable format. */
+    bool canImport(const File& file) const;
+
+    /** Called on the message thread with each batch of files found. */
+    std::function<void(const std::vector<File>&)> onFiles;
+
+    /** Called on the message thread once the walk is over. */
+    std::function<void()> onFinished;
+
+    static constexpr int batchSize = 500; // Files per hand-over to the message thread
+
+private:
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    void addFile(const File& file);
+
+    AudioFormatManager& formatManager;
+    String wildcard; // Every extension the format manager can read
+
+    std::set<String> seen; // Walker thread only
+    std::vector<File> batch; // Walker thread only
+
+    CriticalSection lock;
+    StringArray queuedPaths;   // Guarded by lock
+    std::vector<File> pending; // Guarded by lock
+    bool finished = false;     // Guarded by lock
+    std::atomic<bool> importing{ false }; // Only set under lock, so a drop either joins the running walk or starts a new one
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LibraryImporter)
+};
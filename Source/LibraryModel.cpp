@@ -0,0 +1,217 @@
+#include "LibraryModel.h"
+#include "LoudnessAnalyser.h"
+#include <algorithm>
+
+namespace
+{
+    template <typename Value>
+    size_t getColumnBytes(const std::vector<Value>& column)
+    {
+        return column.capacity() * sizeof(Value);
+    }
+
+    /** Heap bytes behind a String: its header plus the text, rounded as juce allocates it */
+    size_t getTextBytes(const String& text)
+    {
+        if (text.isEmpty())
+            return 0; // Every empty String shares one static buffer
+
+        return sizeof(int) + sizeof(size_t) + (((size_t) text.getNumBytesAsUTF8() + 1 + 3) & ~(size_t) 3);
+    }
+
+    /** Keep the values whose keep flag is set, in order */
+    template <typename Value>
+    void compact(std::vector<Value>& column, const std::vector<bool>& keep)
+    {
+        size_t out = 0;
+
+        for (size_t row = 0; row < column.size(); ++row)
+            if (keep[row])
+                column[out++] = std::move(column[row]);
+
+        column.resize(out);
+    }
+}
+
+//==============================================================================
+uint32 LibraryModel::StringPool::intern(const String& text)
+{
+    if (text.isEmpty())
+        return 0;
+
+    if (ids.contains(text))
+        return ids[text];
+
+    const auto id = (uint32) strings.size();
+    strings.push_back(text);
+    ids.set(text, id);
+    return id;
+}
+
+void LibraryModel::StringPool::clear()
+{
+    strings.assign(1, String());
+    ids.clear();
+}
+
+size_t LibraryModel::StringPool::getMemoryUsage() const
+{
+    size_t bytes = getColumnBytes(strings);
+
+    for (const auto& text : strings)
+        bytes += getTextBytes(text);
+
+    // The map's keys share the strings' text; each entry is a node plus a slot
+    bytes += (size_t) ids.size() * (sizeof(String) + sizeof(uint32) + sizeof(void*)) + (size_t) ids.getNumSlots() * sizeof(void*);
+    return bytes;
+}
+
+//==============================================================================
+int LibraryModel::add(const Track& track)
+{
+    const size_t row = titles.size();
+    const size_t newSize = row + 1;
+
+    titles.resize(newSize);
+    filePaths.resize(newSize);
+    artistIds.resize(newSize);
+    albumIds.resize(newSize);
+    genreIds.resize(newSize);
+    keyIds.resize(newSize);
+    bpms.resize(newSize);
+    lengths.resize(newSize);
+    loudnesses.resize(newSize);
+    truePeaks.resize(newSize);
+    fileSizes.resize(newSize);
+    modificationTimes.resize(newSize);
+    flags.resize(newSize);
+
+    store(row, track);
+    return (int) row;
+}
+
+void LibraryModel::set(int row, const Track& track)
+{
+    jassert(isPositiveAndBelow(row, size()));
+    store((size_t) row, track);
+}
+
+void LibraryModel::store(size_t row, const Track& track)
+{
+    titles[row] = track.title;
+    filePaths[row] = track.filePath;
+    artistIds[row] = pool.intern(track.artist);
+    albumIds[row] = pool.intern(track.album);
+    genreIds[row] = pool.intern(track.genre);
+    keyIds[row] = pool.intern(track.key);
+    bpms[row] = (float) track.bpm;
+    lengths[row] = (float) track.lengthSeconds;
+    loudnesses[row] = track.loudness;
+    truePeaks[row] = track.truePeak;
+    fileSizes[row] = track.fileSize;
+    modificationTimes[row] = track.modificationTime;
+    flags[row] = (uint8) ((track.scanned ? scannedFlag : 0) | (track.hasLoudness ? loudnessFlag : 0));
+}
+
+LibraryModel::Track LibraryModel::get(int row) const
+{
+    jassert(isPositiveAndBelow(row, size()));
+    const auto r = (size_t) row;
+
+    Track track;
+    track.filePath = filePaths[r];
+    track.title = titles[r];
+    track.artist = getArtist(row);
+    track.album = getAlbum(row);
+    track.genre = getGenre(row);
+    track.key = getKey(row);
+    track.bpm = bpms[r];
+    track.lengthSeconds = lengths[r];
+    track.loudness = loudnesses[r];
+    track.truePeak = truePeaks[r];
+    track.hasLoudness = hasLoudness(row);
+    track.scanned = isScanned(row);
+    track.fileSize = fileSizes[r];
+    track.modificationTime = modificationTimes[r];
+    return track;
+}
+
+void LibraryModel::remove(std::vector<int> rows)
+{
+    if (rows.empty())
+        return;
+
+    // One pass over each column, however many rows go
+    std::vector<bool> keep(titles.size(), true);
+    for (const int row : rows)
+        if (isPositiveAndBelow(row, size()))
+            keep[(size_t) row] = false;
+
+    compact(titles, keep);
+    compact(filePaths, keep);
+    compact(artistIds, keep);
+    compact(albumIds, keep);
+    compact(genreIds, keep);
+    compact(keyIds, keep);
+    compact(bpms, keep);
+    compact(lengths, keep);
+    compact(loudnesses, keep);
+    compact(truePeaks, keep);
+    compact(fileSizes, keep);
+    compact(modificationTimes, keep);
+    compact(flags, keep);
+}
+
+void LibraryModel::clear()
+{
+    titles.clear();
+    filePaths.clear();
+    artistIds.clear();
+    albumIds.clear();
+    genreIds.clear();
+    keyIds.clear();
+    bpms.clear();
+    lengths.clear();
+    loudnesses.clear();
+    truePeaks.clear();
+    fileSizes.clear();
+    modificationTimes.clear();
+    flags.clear();
+    pool.clear();
+}
+
+//==============================================================================
+float LibraryModel::getNormalisationGainDb(int row) const
+{
+    return hasLoudness(row) ? LoudnessAnalyser::getNormalisationGainDb(loudnesses[(size_t) row], truePeaks[(size_t) row]) : 0.0f;
+}
+
+String LibraryModel::getDurationText(int row) const
+{
+    if (!isScanned(row))
+        return "Scanning...";
+
+    const float lengthSeconds = lengths[(size_t) row];
+    if (lengthSeconds < 0.0f)
+        return "Unknown Duration";
+
+    const int seconds = static_cast<int>(lengthSeconds) % 60;
+    const int minutes = static_cast<int>(lengthSeconds / 60) % 60;
+    return String::formatted("%02d:%02d", minutes, seconds);
+}
+
+size_t LibraryModel::getMemoryUsage() const
+{
+    size_t bytes = getColumnBytes(titles) + getColumnBytes(filePaths)
+                 + getColumnBytes(artistIds) + getColumnBytes(albumIds) + getColumnBytes(genreIds) + getColumnBytes(keyIds)
+                 + getColumnBytes(bpms) + getColumnBytes(lengths) + getColumnBytes(loudnesses) + getColumnBytes(truePeaks)
+                 + getColumnBytes(fileSizes) + getColumnBytes(modificationTimes) + getColumnBytes(flags);
+
+    for (const auto& title : titles)
+        bytes += getTextBytes(title);
+
+    for (const auto& path : filePaths)
+        bytes += getTextBytes(path);
+
+    return bytes + pool.getMemoryUsage();
+}
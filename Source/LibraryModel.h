@@ -0,0 +1,109 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LibraryDatabase.h"
+#include <vector>
+
+//==============================================================================
+/**
+ * The library's tracks, stored column by column.
+ *
+ * Each field is its own array indexed by row, so painting a column or scanning
+ * one field across the library only touches that field's memory. Artist,
+ * album, genre and key repeat across many tracks, so they are interned: the
+ * row holds a 32-bit id into a pool that keeps one copy of each distinct
+ * string. Lengths are stored as numbers and formatted only when painted.
+ *
+ * Tracks go in and come out as LibraryDatabase::Track, the same record the
+ * database stores.
+ */
+class LibraryModel
+{
+public:
+    using Track = LibraryDatabase::Track;
+
+    /** Add a track at the end and return its row. */
+    int add(const Track& track);
+
+    /** Replace a row's track. */
+    void set(int row, const Track& track);
+
+    /** Copy a row's track out. */
+    Track get(int row) const;
+
+    /** Remove rows, given in any order. Later rows move up to fill the gaps. */
+    void remove(std::vector<int> rows);
+
+    void clear();
+
+    int size() const { return (int) titles.size(); }
+
+    const String& getTitle(int row) const { return titles[(size_t) row]; }
+    const String& getFilePath(int row) const { return filePaths[(size_t) row]; }
+    const String& getArtist(int row) const { return pool.get(artistIds[(size_t) row]); } // Empty if untagged
+    const String& getAlbum(int row) const { return pool.get(albumIds[(size_t) row]); }   // Empty if untagged
+    const String& getGenre(int row) const { return pool.get(genreIds[(size_t) row]); }
+    const String& getKey(int row) const { return pool.get(keyIds[(size_t) row]); }       // Musical key as tagged
+
+    /** Pool ids of the interned fields: rows with equal ids have equal text. Ids keep their text until clear(). */
+    uint32 getArtistId(int row) const { return artistIds[(size_t) row]; }
+    uint32 getAlbumId(int row) const { return albumIds[(size_t) row]; }
+    uint32 getGenreId(int row) const { return genreIds[(size_t) row]; }
+    uint32 getKeyId(int row) const { return keyIds[(size_t) row]; }
+
+    float getBpm(int row) const { return bpms[(size_t) row]; }                    // 0 if unknown
+    float getLengthSeconds(int row) const { return lengths[(size_t) row]; }       // Negative if the file couldn't be decoded
+    float getLoudness(int row) const { return loudnesses[(size_t) row]; }
+    bool isScanned(int row) const { return (flags[(size_t) row] & scannedFlag) != 0; }
+    bool hasLoudness(int row) const { return (flags[(size_t) row] & loudnessFlag) != 0; }
+    int64 getFileSize(int row) const { return fileSizes[(size_t) row]; }
+    int64 getModificationTime(int row) const { return modificationTimes[(size_t) row]; }
+
+    /** Mark a row as needing a rescan, e.g. because its file changed on disk. */
+    void setUnscanned(int row) { flags[(size_t) row] &= (uint8) ~scannedFlag; }
+
+    /** Gain offset to apply when loading this row onto a deck. */
+    float getNormalisationGainDb(int row) const;
+
+    /** The Duration column's text for a row. */
+    String getDurationText(int row) const;
+
+    /** Bytes held by the tracks: the columns, the strings they own and the pool. Shared strings count once. */
+    size_t getMemoryUsage() const;
+
+private:
+    /** One copy of each distinct string. Id 0 is the empty string. */
+    class StringPool
+    {
+    public:
+        StringPool() { clear(); }
+
+        uint32 intern(const String& text);
+        const String& get(uint32 id) const { return strings[(size_t) id]; }
+        void clear();
+        size_t getMemoryUsage() const;
+
+    private:
+        std::vector<String> strings;
+        HashMap<String, uint32> ids;
+    };
+
+    enum Flags : uint8
+    {
+        scannedFlag = 1,
+        loudnessFlag = 2
+    };
+
+    void store(size_t row, const Track& track);
+
+    std::vector<String> titles;
+    std::vector<String> filePaths;
+    std::vector<uint32> artistIds, albumIds, genreIds, keyIds; // Into pool
+    std::vector<float> bpms;
+    std::vector<float> lengths;
+    std::vector<float> loudnesses;                             // Integrated loudness in LUFS
+    std::vector<float> truePeaks;                              // True peak in dBTP
+    std::vector<int64> fileSizes, modificationTimes;           // As of the last scan, to spot changed files
+    std::vector<uint8> flags;
+    StringPool pool;
+};
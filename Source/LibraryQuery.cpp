@@ -0,0 +1,131 @@
+#include "LibraryQuery.h"
+
+namespace
+{
+    enum class Unit { plain, duration };
+
+    bool parseNumber(const String& text, Unit unit, double& result)
+    {
+        const String t = text.trim();
+
+        if (t.isEmpty() || !t.containsOnly("0123456789.:-+"))
+            return false;
+
+        if (unit == Unit::duration && t.containsChar(':'))
+        {
+            result = t.upToFirstOccurrenceOf(":", false, false).getDoubleValue() * 60.0
+                   + t.fromFirstOccurrenceOf(":", false, false).getDoubleValue();
+            return true;
+        }
+
+        result = t.getDoubleValue();
+        return true;
+    }
+
+    /** "a-b", "a..b", ">a", "<a" or a single value, which matches within half a unit */
+    LibraryQuery::Range parseRange(const String& text, Unit unit)
+    {
+        LibraryQuery::Range range;
+        double a = 0.0, b = 0.0;
+
+        if (text.startsWithChar('>') || text.startsWithChar('<'))
+        {
+            const bool isMinimum = text.startsWithChar('>');
+            if (parseNumber(text.trimCharactersAtStart("<>="), unit, a))
+            {
+                (isMinimum ? range.min : range.max) = a;
+                range.active = true;
+            }
+            return range;
+        }
+
+        // Skip a leading minus sign when looking for the dash, so "-14--8" splits as -14 and -8
+        const int dots = text.indexOf("..");
+        const int dash = text.indexOfChar(1, '-');
+        const int split = dots >= 0 ? dots : dash;
+
+        if (split > 0)
+        {
+            if (parseNumber(text.substring(0, split), unit, a)
+                && parseNumber(text.substring(split + (dots >= 0 ? 2 : 1)), unit, b))
+            {
+                range.min = jmin(a, b);
+                range.max = jmax(a, b);
+                range.active = true;
+            }
+            return range;
+        }
+
+        if (parseNumber(text, unit, a))
+        {
+            range.min = a - 0.5;
+            range.max = a + 0.5;
+            range.active = true;
+        }
+
+        return range;
+    }
+
+    int fieldNamed(const String& name)
+    {
+        if (name == "title") return LibrarySearchIndex::title;
+        if (name == "artist") return LibrarySearchIndex::artist;
+        if (name == "album") return LibrarySearchIndex::album;
+        if (name == "genre") return LibrarySearchIndex::genre;
+        if (name == "key") return LibrarySearchIndex::key;
+        return -1;
+    }
+
+    /** Split on whitespace, keeping "quoted phrases" (and field:"quoted phrases") together */
+    StringArray tokenise(const String& text)
+    {
+        StringArray tokens;
+        String current;
+        bool inQuotes = false;
+
+        for (auto p = text.getCharPointer(); !p.isEmpty(); ++p)
+        {
+            const juce_wchar c = *p;
+
+            if (c == '"')
+                inQuotes = !inQuotes;
+            else if (!inQuotes && CharacterFunctions::isWhitespace(c))
+                tokens.add(std::exchange(current, {}));
+            else
+                current += c;
+        }
+
+        tokens.add(current);
+        tokens.removeEmptyStrings();
+        return tokens;
+    }
+}
+
+//==============================================================================
+LibraryQuery LibraryQuery::parse(const String& text)
+{
+    LibraryQuery query;
+
+    for (const auto& token : tokenise(text))
+    {
+        const int colon = token.indexOfChar(':');
+        const String name = colon > 0 ? token.substring(0, colon).toLowerCase() : String();
+        const String value = token.substring(colon + 1);
+
+        if (value.isEmpty())
+            continue; // "artist:" on its own while the user is still typing
+
+        if (name == "bpm")
+            query.bpm = parseRange(value, Unit::plain);
+        else if (name == "duration" || name == "length")
+            query.duration = parseRange(value, Unit::duration);
+        else if (name == "loudness" || name == "lufs")
+            query.loudness = parseRange(value, Unit::plain);
+        else if (fieldNamed(name) >= 0)
+            query.terms.push_back({ LibrarySearchIndex::normalise(value), fieldNamed(name) });
+        else
+            query.terms.push_back({ LibrarySearchIndex::normalise(token), -1 });
+    }
+
+    return query;
+}
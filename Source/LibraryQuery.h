@@ -0,0 +1,44 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LibrarySearchIndex.h"
+#include <string>
+#include <vector>
+
+//==============================================================================
+/**
+ * A parsed library search.
+ *
+ * Plain words match any text field. Other forms:
+ *   artist:daft  title:"one more time"  album:  genre:  key:
+ *   bpm:120-128  bpm:>140  bpm:128
+ *   duration:3:00-5:30  duration:<240  (m:ss or seconds; "length:" also works)
+ *   loudness:-14..-8  loudness:>-10  (LUFS; "lufs:" also works)
+ * Every term and range must match for a track to be listed.
+ */
+struct LibraryQuery
+{
+    struct Term
+    {
+        std::string text; // Normalised as by LibrarySearchIndex::normalise
+        int field = -1;   // A LibrarySearchIndex::Field, or -1 for any text field
+    };
+
+    struct Range
+    {
+        double min = -std::numeric_limits<double>::infinity();
+        double max = std::numeric_limits<double>::infinity();
+        bool active = false;
+
+        bool contains(double value) const { return !active || (value >= min && value <= max); }
+    };
+
+    std::vector<Term> terms;
+    Range bpm;
+    Range duration; // Seconds
+    Range loudness; // LUFS
+
+    bool isEmpty() const { return terms.empty() && !bpm.active && !duration.active && !loudness.active; }
+
+    static LibraryQuery parse(const String& text);
+};
@@ -0,0 +1,176 @@
+#include "LibraryScanner.h"
+#include "LoudnessAnalyser.h"
+
+//==============================================================================
+class LibraryScanner::ScanJob : public ThreadPoolJob
+{
+public:
+    ScanJob(LibraryScanner& s, const File& f, int gen)
+        : ThreadPoolJob("Library scan"), scanner(s), file(f), generation(gen)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        Result result;
+        result.filePath = file.getFullPathName();
+        File fileToMeasure;
+
+        // Skip the work entirely if the library was cleared while this job was queued
+        if (!isCancelled())
+        {
+            result.fileSize = file.getSize();
+            result.modificationTime = file.getLastModificationTime().toMilliseconds();
+
+            // Tags come straight from the header bytes, before any decoder is opened
+            result.tags = TagReader::read(file);
+
+            std::unique_ptr<AudioFormatReader> reader(isCancelled() ? nullptr : scanner.formatManager.createReaderFor(file));
+
+            if (reader != nullptr && reader->sampleRate > 0.0)
+            {
+                result.lengthSeconds = reader->lengthInSamples / reader->sampleRate;
+
+                // Decoding the whole file takes far longer than this, so it waits its turn behind the other probes
+                fileToMeasure = file;
+            }
+        }
+
+        scanner.addResult(result, generation, fileToMeasure);
+        return jobHasFinished;
+    }
+
+private:
+    /** Shutting down, or the library was cleared */
+    bool isCancelled() { return shouldExit() || scanner.generation.load() != generation; }
+
+    LibraryScanner& scanner;
+    File file;
+    int generation;
+};
+
+//==============================================================================
+class LibraryScanner::LoudnessJob : public ThreadPoolJob
+{
+public:
+    LoudnessJob(LibraryScanner& s, const File& f, int gen)
+        : ThreadPoolJob("Library loudness"), scanner(s), file(f), generation(gen)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        Result result;
+        result.filePath = file.getFullPathName();
+        result.loudnessOnly = true;
+
+        if (!isCancelled())
+        {
+            std::unique_ptr<AudioFormatReader> reader(scanner.formatManager.createReaderFor(file));
+
+            if (reader != nullptr && reader->sampleRate > 0.0)
+            {
+                // Measure loudness once while scanning so decks can level-match on load. Decoding a
+                // long file takes seconds, so it stops part-way if the scanner is shut down or cleared
+                auto loudness = LoudnessAnalyser::analyse(*reader, [this] { return isCancelled(); });
+                result.loudness = loudness.integratedLufs;
+                result.truePeak = loudness.truePeakDb;
+                result.hasLoudness = loudness.valid;
+            }
+        }
+
+        scanner.addResult(result, generation);
+        return jobHasFinished;
+    }
+
+private:
+    /** Shutting down, or the library was cleared */
+    bool isCancelled() { return shouldExit() || scanner.generation.load() != generation; }
+
+    LibraryScanner& scanner;
+    File file;
+    int generation;
+};
+
+//==============================================================================
+LibraryScanner::LibraryScanner(AudioFormatManager& fm, int numThreads)
+    : formatManager(fm), pool(numThreads)
+{
+}
+
+LibraryScanner::~LibraryScanner()
+{
+    cancelAll();
+    pool.removeAllJobs(true, 10000);
+}
+
+void LibraryScanner::scan(const File& file)
+{
+    ++numOutstanding;
+    ++numProbesOutstanding;
+    pool.addJob(new ScanJob(*this, file, generation.load()), true);
+}
+
+void LibraryScanner::analyseLoudness(const File& file)
+{
+    queueLoudness(file, generation.load());
+}
+
+void LibraryScanner::queueLoudness(const File& file, int jobGeneration)
+{
+    const ScopedLock sl(resultLock);
+
+    if (jobGeneration != generation.load())
+        return;
+
+    ++numOutstanding;
+    pool.addJob(new LoudnessJob(*this, file, jobGeneration), true);
+}
+
+void LibraryScanner::cancelAll()
+{
+    {
+        const ScopedLock sl(resultLock);
+        ++generation;
+        numOutstanding = 0;
+        numProbesOutstanding = 0;
+        results.clear();
+    }
+
+    // Queued jobs are removed; running ones finish in the background and are ignored
+    pool.removeAllJobs(true, 0);
+}
+
+std::vector<LibraryScanner::Result> LibraryScanner::takeResults()
+{
+    std::vector<Result> batch;
+
+    const ScopedLock sl(resultLock);
+    batch.swap(results);
+    return batch;
+}
+
+bool LibraryScanner::isBusy() const
+{
+    const ScopedLock sl(resultLock);
+    return numOutstanding.load() > 0 || !results.empty();
+}
+
+void LibraryScanner::addResult(const Result& result, int jobGeneration, const File& fileToMeasure)
+{
+    const ScopedLock sl(resultLock);
+
+    if (jobGeneration != generation.load())
+        return;
+
+    results.push_back(result);
+    --numOutstanding;
+
+    if (!result.loudnessOnly)
+        --numProbesOutstanding;
+
+    // Only once the probe is in, so the measurement can't overtake it and be reset by it; and under
+    // the same lock, so the scanner never looks idle in between
+    if (fileToMeasure != File())
+        queueLoudness(fileToMeasure, jobGeneration);
+}
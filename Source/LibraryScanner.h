@@ -0,0 +1,77 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "TagReader.h"
+#include <vector>
+
+//==============================================================================
+/**
+ * Opens library files on a pool of worker threads and hands the results back
+ * in batches, so a large library never blocks the message thread.
+ *
+ * Each file is read in two passes. The probe reads the tags and the length,
+ * which only takes the file's header, so a big import fills the table quickly.
+ * Probing a decodable file queues the second pass, which decodes the whole
+ * file to measure its loudness. Those jobs join the back of the queue, behind
+ * the probes already waiting.
+ *
+ * Workers append their results, keyed by file path, to a shared batch, which
+ * the UI collects with takeResults() on a timer and applies all at once. cancelAll() starts a new generation, so results from
+ * jobs that were already running when the library was cleared are dropped.
+ */
+class LibraryScanner
+{
+public:
+    struct Result
+    {
+        String filePath;
+        double lengthSeconds = -1.0; // Negative if the file couldn't be opened
+        float loudness = 0.0f;       // Integrated loudness in LUFS
+        float truePeak = 0.0f;       // True peak in dBTP
+        bool hasLoudness = false;
+        int64 fileSize = 0;          // Identify this version of the file, so later changes can be spotted
+        int64 modificationTime = 0;
+        TrackTags tags;
+        bool loudnessOnly = false;   // From the second pass: only the loudness fields are filled in
+    };
+
+    explicit LibraryScanner(AudioFormatManager& formatManager,
+        int numThreads = jmax(1, SystemStats::getNumCpus() - 1));
+    ~LibraryScanner();
+
+    /** Queue a file to be probed, then measured for loudness. */
+    void scan(const File& file);
+
+    /** Queue only the loudness pass, for a file that was probed before but never measured. */
+    void analyseLoudness(const File& file);
+
+    /** Drop every queued file and any results not yet collected. */
+    void cancelAll();
+
+    /** Move out everything finished since the last call. Message thread only. */
+    std::vector<Result> takeResults();
+
+    /** True while files are queued, being read or waiting to be collected. */
+    bool isBusy() const;
+
+    /** Files queued or being read whose probe hasn't finished. */
+    int getNumProbesOutstanding() const { return numProbesOutstanding.load(); }
+
+private:
+    class ScanJob;
+    class LoudnessJob;
+    void queueLoudness(const File& file, int generation);
+    void addResult(const Result& result, int generation, const File& fileToMeasure = {});
+
+    AudioFormatManager& formatManager;
+
+    CriticalSection resultLock;
+    std::vector<Result> results; // Guarded by resultLock
+    std::atomic<int> generation{ 0 };
+    std::atomic<int> numOutstanding{ 0 }; // Queued or running jobs of the current generation
+    std::atomic<int> numProbesOutstanding{ 0 }; // Of those, the ones probing
+
+    ThreadPool pool; // Last, so its workers are stopped before the members above go away
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LibraryScanner)
+};
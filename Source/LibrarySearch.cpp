@@ -0,0 +1,315 @@
+#include "LibrarySearch.h"
+#include <algorithm>
+#include <string_view>
+
+namespace
+{
+    using Trigram = LibrarySearchIndex::Trigram;
+
+    // Indexed by LibrarySearchIndex::Field
+    constexpr float fieldWeights[LibrarySearchIndex::numFields] = { 1.0f, 0.9f, 0.7f, 0.5f, 0.5f };
+
+    // How much a term is worth, by the way it matched
+    constexpr float wholeFieldMatch = 1.0f;
+    constexpr float wholeWordMatch = 0.8f;
+    constexpr float wordPrefixMatch = 0.7f;
+    constexpr float substringMatch = 0.5f;
+    constexpr float oneEditMatch = 0.3f;
+    constexpr float twoEditMatch = 0.2f;
+
+    constexpr size_t maxFuzzyLength = 64; // Longer terms only match exactly
+
+    bool isWordByte(char c)
+    {
+        const auto u = (uint8) c;
+        return u >= 0x80 || CharacterFunctions::isLetterOrDigit((char) u);
+    }
+
+    /** Edit distance between the term and the closest prefix of the word, or maxEdits + 1 if over the allowance */
+    int prefixEditDistance(std::string_view term, std::string_view word, int maxEdits)
+    {
+        const size_t m = term.size();
+        const size_t n = jmin(word.size(), m + (size_t) maxEdits); // Longer prefixes can only be further away
+
+        int previous[maxFuzzyLength + 3], current[maxFuzzyLength + 3];
+
+        for (size_t j = 0; j <= n; ++j)
+            previous[j] = (int) j;
+
+        for (size_t i = 1; i <= m; ++i)
+        {
+            current[0] = (int) i;
+            int rowMinimum = current[0];
+
+            for (size_t j = 1; j <= n; ++j)
+            {
+                const int substitution = previous[j - 1] + (term[i - 1] == word[j - 1] ? 0 : 1);
+                current[j] = jmin(substitution, previous[j] + 1, current[j - 1] + 1);
+                rowMinimum = jmin(rowMinimum, current[j]);
+            }
+
+            if (rowMinimum > maxEdits)
+                return maxEdits + 1;
+
+            std::copy(current, current + n + 1, previous);
+        }
+
+        return jmin(*std::min_element(previous, previous + n + 1), maxEdits + 1);
+    }
+
+    /** How well the term matches the field, from 0 (not at all) to wholeFieldMatch */
+    float matchField(std::string_view field, std::string_view term, int maxEdits)
+    {
+        if (field.empty())
+            return 0.0f;
+
+        if (field == term)
+            return wholeFieldMatch;
+
+        float best = 0.0f;
+
+        for (size_t pos = field.find(term); pos != std::string_view::npos && best < wholeWordMatch; pos = field.find(term, pos + 1))
+        {
+            const size_t end = pos + term.size();
+            const bool startsWord = pos == 0 || !isWordByte(field[pos - 1]);
+            const bool endsWord = end == field.size() || !isWordByte(field[end]);
+
+            best = jmax(best, startsWord ? (endsWord ? wholeWordMatch : wordPrefixMatch) : substringMatch);
+        }
+
+        if (best > 0.0f || maxEdits == 0 || term.size() > maxFuzzyLength)
+            return best;
+
+        // No exact occurrence: compare the term with the start of each word, allowing a typo or two
+        int bestDistance = maxEdits + 1;
+
+        for (size_t start = 0; start < field.size() && bestDistance > 1;)
+        {
+            while (start < field.size() && !isWordByte(field[start]))
+                ++start;
+
+            size_t end = start;
+            while (end < field.size() && isWordByte(field[end]))
+                ++end;
+
+            if (end > start)
+                bestDistance = jmin(bestDistance, prefixEditDistance(term, field.substr(start, end - start), maxEdits));
+
+            start = end;
+        }
+
+        if (bestDistance > maxEdits)
+            return 0.0f;
+
+        return bestDistance == 1 ? oneEditMatch : twoEditMatch;
+    }
+
+    std::vector<int> intersect(const std::vector<int>& a, const std::vector<int>& b)
+    {
+        const auto& shorter = a.size() <= b.size() ? a : b;
+        const auto& longer = a.size() <= b.size() ? b : a;
+        std::vector<int> both;
+        both.reserve(shorter.size());
+
+        if (longer.size() < shorter.size() * 16)
+        {
+            // Similar sizes: a linear merge
+            std::set_intersection(shorter.begin(), shorter.end(), longer.begin(), longer.end(), std::back_inserter(both));
+        }
+        else
+        {
+            // A much longer list: binary search it for each of the shorter one's rows
+            for (const int row : shorter)
+                if (std::binary_search(longer.begin(), longer.end(), row))
+                    both.push_back(row);
+        }
+
+        return both;
+    }
+}
+
+//==============================================================================
+LibrarySearch::LibrarySearch(const LibrarySearchIndex& i, LibraryQuery q)
+    : index(i), query(std::move(q))
+{
+    if (!query.isEmpty())
+        gatherCandidates();
+}
+
+void LibrarySearch::gatherCandidates()
+{
+    std::vector<int> narrowed;
+    bool anyTermNarrowed = false;
+
+    for (const auto& term : query.terms)
+    {
+        std::vector<Trigram> trigrams;
+        LibrarySearchIndex::forEachTrigram(term.text, [&trigrams](Trigram t) { trigrams.push_back(t); });
+        std::sort(trigrams.begin(), trigrams.end());
+        trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+        // Each edit can break up to three trigrams, so that many fewer need to be present
+        const int maxEdits = getMaxEdits(term.text.size());
+        const int threshold = (int) trigrams.size() - 3 * maxEdits;
+
+        if (threshold <= 0)
+            continue; // Too short to narrow anything down
+
+        std::vector<int> termRows;
+
+        if (maxEdits == 0)
+        {
+            // Exact: every trigram must be there, so intersect the lists, rarest first
+            std::vector<const std::vector<int>*> lists;
+            for (const Trigram t : trigrams)
+            {
+                const auto* list = index.getPostings(t);
+                if (list == nullptr)
+                {
+                    candidates.clear();
+                    return; // A trigram no row has: nothing can match
+                }
+                lists.push_back(list);
+            }
+
+            std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+            termRows = *lists.front();
+
+            for (size_t l = 1; l < lists.size() && !termRows.empty(); ++l)
+                termRows = intersect(termRows, *lists[l]);
+        }
+        else
+        {
+            // Fuzzy: count how many of the term's trigrams each row has
+            std::vector<uint16> counts((size_t) index.getNumRows(), 0);
+            for (const Trigram t : trigrams)
+                if (const auto* list = index.getPostings(t))
+                    for (const int row : *list)
+                        ++counts[(size_t) row];
+
+            for (int row = 0; row < index.getNumRows(); ++row)
+                if (counts[(size_t) row] >= threshold)
+                    termRows.push_back(row);
+        }
+
+        narrowed = anyTermNarrowed ? intersect(narrowed, termRows) : std::move(termRows);
+        anyTermNarrowed = true;
+
+        if (narrowed.empty())
+            break;
+    }
+
+    allRows = !anyTermNarrowed;
+    candidates = std::move(narrowed);
+}
+
+float LibrarySearch::scoreRow(int row) const
+{
+    // Numeric columns first: they're the cheapest to reject on
+    if (query.bpm.active && (index.getBpm(row) <= 0.0f || !query.bpm.contains(index.getBpm(row))))
+        return -1.0f;
+
+    if (query.duration.active && (index.getLengthSeconds(row) < 0.0f || !query.duration.contains(index.getLengthSeconds(row))))
+        return -1.0f;
+
+    if (query.loudness.active && (std::isnan(index.getLoudness(row)) || !query.loudness.contains(index.getLoudness(row))))
+        return -1.0f;
+
+    // Split the row's text back into its fields
+    std::string_view fields[LibrarySearchIndex::numFields];
+    {
+        const std::string_view text = index.getText(row);
+        size_t start = 0;
+
+        for (int f = 0; f < LibrarySearchIndex::numFields; ++f)
+        {
+            const size_t end = jmin(text.find('\n', start), text.size());
+            fields[f] = text.substr(jmin(start, text.size()), end - jmin(start, text.size()));
+            start = end + 1;
+        }
+    }
+
+    float total = 0.0f;
+
+    for (const auto& term : query.terms)
+    {
+        const int maxEdits = getMaxEdits(term.text.size());
+        float best = 0.0f;
+
+        for (int f = 0; f < LibrarySearchIndex::numFields; ++f)
+            if (term.field < 0 || term.field == f)
+                best = jmax(best, matchField(fields[f], term.text, maxEdits) * fieldWeights[f]);
+
+        if (best <= 0.0f)
+            return -1.0f;
+
+        total += best;
+    }
+
+    return total;
+}
+
+bool LibrarySearch::step(double budgetMs)
+{
+    if (finished)
+        return true;
+
+    const double startMs = Time::getMillisecondCounterHiRes();
+
+    if (query.isEmpty())
+    {
+        // Nothing to rank by: the whole library, in its own order
+        matches.reserve((size_t) index.getNumRows());
+        latestRows.resize((size_t) index.getNumRows());
+        for (int row = 0; row < index.getNumRows(); ++row)
+        {
+            matches.push_back({ row, 0.0f });
+            latestRows[(size_t) row] = row;
+        }
+
+        return finished = true;
+    }
+
+    const size_t total = allRows ? (size_t) index.getNumRows() : candidates.size();
+    std::vector<Match> slice;
+
+    while (cursor < total)
+    {
+        const int row = allRows ? (int) cursor : candidates[cursor];
+        ++cursor;
+
+        const float score = scoreRow(row);
+        if (score >= 0.0f)
+            slice.push_back({ row, score });
+
+        // Reading the clock is cheap next to scoring, but not free
+        if ((cursor & 127) == 0 && Time::getMillisecondCounterHiRes() - startMs >= budgetMs)
+            break;
+    }
+
+    latestRows.clear();
+    for (const auto& m : slice)
+        latestRows.push_back(m.row);
+
+    // Slices arrive in row order; merge each into the ranked results
+    auto isBetter = [](const Match& a, const Match& b) { return a.score != b.score ? a.score > b.score : a.row < b.row; };
+    std::sort(slice.begin(), slice.end(), isBetter);
+
+    const auto middle = (std::ptrdiff_t) matches.size();
+    matches.insert(matches.end(), slice.begin(), slice.end());
+    std::inplace_merge(matches.begin(), matches.begin() + middle, matches.end(), isBetter);
+
+    finished = cursor >= total;
+    return finished;
+}
+
+std::vector<int> LibrarySearch::getRows() const
+{
+    std::vector<int> rows;
+    rows.reserve(matches.size());
+
+    for (const auto& m : matches)
+        rows.push_back(m.row);
+
+    return rows;
+}
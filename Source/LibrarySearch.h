@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LibraryQuery.h"
+#include "LibrarySearchIndex.h"
+#include <vector>
+
+//==============================================================================
+/**
+ * One run of a query against the index, done a slice at a time so that the
+ * caller can give way to newer queries or to writers between slices.
+ *
+ * The constructor narrows the rows down with the trigram postings, so the index
+ * must be committed and locked against writers while it runs; steps only read
+ * the rows' text and numbers, which writers may change between them. Exact terms
+ * intersect their lists. A fuzzy term keeps rows that share enough of its
+ * trigrams to be within its edit-distance allowance, since each edit destroys
+ * at most three trigrams. Each step scores the next candidates in index order and
+ * merge each slice into the results, so getRows() is always ranked, best first.
+ *
+ * Scores add up over the terms. For each term, the best field wins. A match
+ * is worth most when it is the whole field, then a whole word, then a word
+ * prefix, then any substring, and least as a fuzzy match. Each match is
+ * weighted by field: title highest, then artist, album, then genre and key.
+ * Terms of five or more letters tolerate one typo, and nine or more two.
+ */
+class LibrarySearch
+{
+public:
+    LibrarySearch(const LibrarySearchIndex& index, LibraryQuery query);
+
+    /** Search on for up to budgetMs. Returns true once every row has been considered. */
+    bool step(double budgetMs);
+
+    bool isFinished() const { return finished; }
+
+    /** Matching rows found so far, best first; ties keep library order. */
+    std::vector<int> getRows() const;
+
+    /** Rows the latest step() found, in library order. */
+    const std::vector<int>& getLatestRows() const { return latestRows; }
+
+    /** Typo allowance for a term of this many bytes. */
+    static int getMaxEdits(size_t termLength) { return termLength >= 9 ? 2 : termLength >= 5 ? 1 : 0; }
+
+private:
+    struct Match
+    {
+        int row;
+        float score;
+    };
+
+    void gatherCandidates();
+    float scoreRow(int row) const; // Negative if the row doesn't match
+
+    const LibrarySearchIndex& index;
+    const LibraryQuery query;
+
+    bool allRows = false;     // No term could narrow the search, so every row is a candidate
+    std::vector<int> candidates;
+    size_t cursor = 0;        // Next candidate (or row, if allRows) to score
+    std::vector<Match> matches;
+    std::vector<int> latestRows;
+    bool finished = false;
+};
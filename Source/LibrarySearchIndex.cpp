@@ -0,0 +1,163 @@
+#include "LibrarySearchIndex.h"
+#include <algorithm>
+#include <iterator>
+
+//==============================================================================
+std::string LibrarySearchIndex::normalise(const String& text)
+{
+    return text.toLowerCase().toStdString();
+}
+
+void LibrarySearchIndex::setRow(int row, const Row& data)
+{
+    jassert(row >= 0 && row <= getNumRows());
+
+    // Newlines separate the fields, so one inside a field becomes a space
+    std::string text;
+    for (int f = 0; f < numFields; ++f)
+    {
+        if (f > 0)
+            text += '\n';
+
+        auto field = normalise(data.fields[f]);
+        std::replace(field.begin(), field.end(), '\n', ' ');
+        text += field;
+    }
+
+    if (row == getNumRows())
+    {
+        texts.emplace_back();
+        bpmColumn.push_back(0.0f);
+        lengthColumn.push_back(0.0f);
+        loudnessColumn.push_back(0.0f);
+    }
+    else if (texts[(size_t) row] == text)
+    {
+        setNumbers(row, data); // Only the numbers can have changed; the lists already hold the row
+        return;
+    }
+    else
+    {
+        // Trigrams the row is losing; commit() takes it out of their lists
+        std::vector<Trigram> oldTrigrams, newTrigrams, lost;
+        forEachTrigram(texts[(size_t) row], [&oldTrigrams](Trigram t) { oldTrigrams.push_back(t); });
+        forEachTrigram(text, [&newTrigrams](Trigram t) { newTrigrams.push_back(t); });
+
+        std::sort(oldTrigrams.begin(), oldTrigrams.end());
+        std::sort(newTrigrams.begin(), newTrigrams.end());
+        std::set_difference(oldTrigrams.begin(), oldTrigrams.end(), newTrigrams.begin(), newTrigrams.end(), std::back_inserter(lost));
+        lost.erase(std::unique(lost.begin(), lost.end()), lost.end());
+
+        for (const Trigram t : lost)
+            staleRows[t].push_back(row);
+    }
+
+    forEachTrigram(text, [this, row](Trigram t)
+        {
+            auto& list = postings[t];
+
+            if (list.empty() || list.back() < row)
+            {
+                list.push_back(row);
+            }
+            else if (list.back() != row)
+            {
+                // Updating an earlier row; put the list back in order at commit()
+                unsortedLists.insert(t);
+                list.push_back(row);
+            }
+        });
+
+    texts[(size_t) row] = std::move(text);
+    setNumbers(row, data);
+}
+
+void LibrarySearchIndex::setNumbers(int row, const Row& data)
+{
+    bpmColumn[(size_t) row] = data.bpm;
+    lengthColumn[(size_t) row] = data.lengthSeconds;
+    loudnessColumn[(size_t) row] = data.loudness;
+}
+
+void LibrarySearchIndex::commit()
+{
+    for (const Trigram t : unsortedLists)
+    {
+        auto& list = postings[t];
+
+        // Everything before the first out-of-order entry is still sorted, so only the tail needs sorting
+        const auto tail = std::is_sorted_until(list.begin(), list.end());
+        std::sort(tail, list.end());
+        std::inplace_merge(list.begin(), tail, list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+
+    unsortedLists.clear();
+
+    for (auto& entry : staleRows)
+    {
+        const Trigram t = entry.first;
+        auto& rows = entry.second;
+        const auto found = postings.find(t);
+
+        if (found == postings.end())
+            continue;
+
+        // A row may have got the trigram back from a later update; those stay
+        const char bytes[] = { (char) (t >> 16), (char) (t >> 8), (char) t };
+        rows.erase(std::remove_if(rows.begin(), rows.end(),
+                       [this, &bytes](int row) { return texts[(size_t) row].find(bytes, 0, 3) != std::string::npos; }),
+            rows.end());
+
+        std::sort(rows.begin(), rows.end());
+        auto& list = found->second;
+        list.erase(std::remove_if(list.begin(), list.end(),
+                       [&rows](int row) { return std::binary_search(rows.begin(), rows.end(), row); }),
+            list.end());
+
+        if (list.empty())
+            postings.erase(found);
+    }
+
+    staleRows.clear();
+}
+
+void LibrarySearchIndex::clear()
+{
+    texts.clear();
+    bpmColumn.clear();
+    lengthColumn.clear();
+    loudnessColumn.clear();
+    postings.clear();
+    unsortedLists.clear();
+    staleRows.clear();
+    ++version;
+}
+
+size_t LibrarySearchIndex::getMemoryUsage() const
+{
+    size_t bytes = texts.capacity() * sizeof(std::string)
+                 + (bpmColumn.capacity() + lengthColumn.capacity() + loudnessColumn.capacity()) * sizeof(float);
+
+    // Short texts live inside the std::string itself
+    for (const auto& text : texts)
+        if (text.capacity() > std::string().capacity())
+            bytes += text.capacity() + 1;
+
+    // Each list is a node plus a bucket, and its rows
+    bytes += postings.size() * (sizeof(std::pair<const Trigram, std::vector<int>>) + sizeof(void*))
+           + postings.bucket_count() * sizeof(void*);
+
+    for (const auto& entry : postings)
+        bytes += entry.second.capacity() * sizeof(int);
+
+    return bytes;
+}
+
+const std::vector<int>* LibrarySearchIndex::getPostings(Trigram trigram) const
+{
+    jassert(unsortedLists.empty()); // Missing a commit()
+
+    const auto found = postings.find(trigram);
+    return found != postings.end() ? &found->second : nullptr;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+//==============================================================================
+/**
+ * In-memory columnar index of the library, which LibrarySearch runs queries against.
+ *
+ * Each row's text fields are lower-cased once, when the row is set, and stored
+ * as one UTF-8 string with the fields separated by '\n'. BPM, length and
+ * loudness are kept in plain float columns. Every three-byte run of the text
+ * has a posting list of the rows containing it, so a search only has to look
+ * at rows that could possibly match.
+ *
+ * Updating a row appends to the posting lists; call commit() after a batch of
+ * updates to put them back in order. When a row's text changes, the trigrams
+ * it no longer has are noted, and commit() drops the row from their lists too,
+ * so the lists never fill up with rows that can't match.
+ */
+class LibrarySearchIndex
+{
+public:
+    enum Field { title, artist, album, genre, key, numFields };
+
+    struct Row
+    {
+        String fields[numFields];
+        float bpm = 0.0f;                                         // 0 if unknown
+        float lengthSeconds = -1.0f;                              // Negative if unknown
+        float loudness = std::numeric_limits<float>::quiet_NaN(); // LUFS; NaN until analysed
+    };
+
+    /** Set a row. Rows are numbered from 0; row may be getNumRows() to add one. */
+    void setRow(int row, const Row& data);
+
+    /** Re-sort the posting lists touched since the last commit, and prune rows they lost. Call before searching. */
+    void commit();
+
+    void clear();
+
+    int getNumRows() const { return (int) texts.size(); }
+
+    /**
+     * Changes whenever the index is cleared, which is how rows get renumbered or removed, so a reader can
+     * tell its row numbers no longer mean the same tracks. Setting a row leaves it alone.
+     */
+    uint32 getVersion() const { return version; }
+
+    /** Bytes held by the text, the number columns and the posting lists. */
+    size_t getMemoryUsage() const;
+
+    /** The row's normalised fields, in Field order, separated by '\n'. */
+    const std::string& getText(int row) const { return texts[(size_t) row]; }
+
+    float getBpm(int row) const { return bpmColumn[(size_t) row]; }
+    float getLengthSeconds(int row) const { return lengthColumn[(size_t) row]; }
+    float getLoudness(int row) const { return loudnessColumn[(size_t) row]; }
+
+    using Trigram = uint32;
+
+    /** Ascending rows whose text contains the trigram, or null if none do. */
+    const std::vector<int>* getPostings(Trigram trigram) const;
+
+    /** Lower-cased UTF-8 form of text, as stored and as queries are matched. */
+    static std::string normalise(const String& text);
+
+    /** Call back with each trigram of the text, in order. */
+    template <typename Callback>
+    static void forEachTrigram(const std::string& text, Callback&& callback)
+    {
+        for (size_t i = 0; i + 3 <= text.size(); ++i)
+        {
+            const auto* bytes = reinterpret_cast<const uint8*>(text.data() + i);
+            callback(((Trigram) bytes[0] << 16) | ((Trigram) bytes[1] << 8) | (Trigram) bytes[2]);
+        }
+    }
+
+private:
+    void setNumbers(int row, const Row& data);
+
+    std::vector<std::string> texts;
+    std::vector<float> bpmColumn;
+    std::vector<float> lengthColumn;
+    std::vector<float> loudnessColumn;
+
+    std::unordered_map<Trigram, std::vector<int>> postings; // Ascending rows, once committed
+    std::unordered_set<Trigram> unsortedLists;              // Lists appended out of order since the last commit
+    std::unordered_map<Trigram, std::vector<int>> staleRows; // Rows whose text lost the trigram since the last commit
+    uint32 version = 0;
+};
@@ -0,0 +1,158 @@
+#include "LibrarySearchWorker.h"
+#include "LibrarySearch.h"
+
+//==============================================================================
+LibrarySearchWorker::LibrarySearchWorker(LibrarySearchIndex& i, ReadWriteLock& lock)
+    : Thread("Library search"), index(i), indexLock(lock)
+{
+    startThread();
+}
+
+LibrarySearchWorker::~LibrarySearchWorker()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread(4000);
+    cancelPendingUpdate();
+}
+
+int LibrarySearchWorker::search(const String& queryText, bool debounce)
+{
+    const int generation = ++latestGeneration;
+    {
+        const ScopedLock sl(requestLock);
+        pendingRequest = { queryText, generation, debounce };
+        hasRequest = true;
+    }
+
+    notify();
+    return generation;
+}
+
+//==============================================================================
+void LibrarySearchWorker::run()
+{
+    while (!threadShouldExit())
+    {
+        Request request;
+        {
+            const ScopedLock sl(requestLock);
+            if (hasRequest)
+            {
+                request = pendingRequest;
+                hasRequest = false;
+            }
+        }
+
+        if (request.generation == 0)
+        {
+            wait(-1);
+            continue;
+        }
+
+        // Another keystroke during the wait supersedes this query; go round for the newer one instead
+        if (request.debounce)
+        {
+            const double endMs = Time::getMillisecondCounterHiRes() + debounceMs;
+
+            for (double nowMs = Time::getMillisecondCounterHiRes(); nowMs < endMs && !isSuperseded(request.generation);
+                 nowMs = Time::getMillisecondCounterHiRes())
+                wait((int) (endMs - nowMs) + 1);
+
+            if (isSuperseded(request.generation))
+                continue;
+        }
+
+        runSearch(request);
+    }
+}
+
+void LibrarySearchWorker::runSearch(const Request& request)
+{
+    const LibraryQuery query = LibraryQuery::parse(request.queryText);
+
+    // Starts again from the top whenever the index changes underneath it
+    for (;;)
+    {
+        std::unique_ptr<LibrarySearch> search;
+        uint32 indexVersion;
+        {
+            // Writers leave the posting lists unsorted; settle them before the search reads them
+            const ScopedWriteLock sl(indexLock);
+            index.commit();
+            indexVersion = index.getVersion();
+            search = std::make_unique<LibrarySearch>(index, query);
+        }
+
+        auto results = std::make_unique<Results>();
+        results->generation = request.generation;
+        double lastPublishMs = Time::getMillisecondCounterHiRes();
+
+        for (;;)
+        {
+            if (isSuperseded(request.generation))
+                return;
+
+            bool finished;
+            {
+                const ScopedReadLock sl(indexLock);
+
+                if (index.getVersion() != indexVersion)
+                    break; // Rows may have been renumbered; start again
+
+                finished = search->step(sliceMs);
+            }
+
+            const auto& found = search->getLatestRows();
+            results->added.insert(results->added.end(), found.begin(), found.end());
+
+            if (finished || Time::getMillisecondCounterHiRes() - lastPublishMs >= publishIntervalMs)
+            {
+                results->ranked = search->getRows();
+                results->complete = finished;
+                publish(std::move(results));
+
+                if (finished)
+                    return;
+
+                results = std::make_unique<Results>();
+                results->generation = request.generation;
+                results->replace = false;
+                lastPublishMs = Time::getMillisecondCounterHiRes();
+            }
+        }
+    }
+}
+
+void LibrarySearchWorker::publish(std::unique_ptr<Results> results)
+{
+    {
+        const ScopedLock sl(resultsLock);
+
+        // Fold into results the message thread hasn't picked up yet, if they're for the same search
+        if (pendingResults != nullptr && pendingResults->generation == results->generation && !results->replace)
+        {
+            pendingResults->added.insert(pendingResults->added.end(), results->added.begin(), results->added.end());
+            pendingResults->ranked = std::move(results->ranked);
+            pendingResults->complete = results->complete;
+        }
+        else
+        {
+            pendingResults = std::move(results);
+        }
+    }
+
+    triggerAsyncUpdate();
+}
+
+void LibrarySearchWorker::handleAsyncUpdate()
+{
+    std::unique_ptr<Results> results;
+    {
+        const ScopedLock sl(resultsLock);
+        results = std::move(pendingResults);
+    }
+
+    if (results != nullptr && onResults != nullptr)
+        onResults(*results);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LibrarySearchIndex.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+/**
+ * Runs library searches on a background thread, so typing in the search box
+ * never waits for the index to be scanned.
+ *
+ * Each search() call supersedes the ones before it. Typed queries wait a short
+ * debounce before starting, so a burst of keystrokes starts one search and not
+ * one per key. A search that has been superseded stops at its next slice.
+ *
+ * The index is shared with the message thread, which changes it under a write
+ * lock on indexLock. The worker reads it under the read lock a slice at a time,
+ * so a writer never waits more than one slice. Rows set while a search runs
+ * are scored as they are when it reaches them; rows it has passed, or that only
+ * now match, are left to the next search. Clearing the index bumps its version.
+ * A search that sees the version change under it starts again, since its row
+ * numbers may no longer mean the same tracks.
+ *
+ * Results are handed over as whole objects: the worker fills one in and swaps
+ * it into place under a lock, and onResults receives it on the message thread.
+ */
+class LibrarySearchWorker : private Thread,
+                            private AsyncUpdater
+{
+public:
+    struct Results
+    {
+        int generation = 0;      // The search() call these answer
+        bool replace = true;     // Throw away what was shown for this search so far, e.g. after a restart
+        bool complete = false;   // No more results will follow for this search
+        std::vector<int> ranked; // Every match so far, best first
+        std::vector<int> added;  // Matches found since the last Results for this search, in library order
+    };
+
+    LibrarySearchWorker(LibrarySearchIndex& index, ReadWriteLock& indexLock);
+    ~LibrarySearchWorker() override;
+
+    /**
+     * Search for queryText (see LibraryQuery) in place of any earlier search.
+     * Returns the generation its results will carry.
+     */
+    int search(const String& queryText, bool debounce);
+
+    /** Called on the message thread as results arrive. Long searches deliver several in turn. */
+    std::function<void(const Results&)> onResults;
+
+    /** Message thread: call onResults now with anything waiting, for callers with no message loop running. */
+    void deliverPendingResults() { handleUpdateNowIfNeeded(); }
+
+    static constexpr int debounceMs = 120;          // Quiet time after a keystroke before searching
+    static constexpr double sliceMs = 5.0;          // Searching done per read lock, and between checks for a newer search
+    static constexpr double publishIntervalMs = 50; // How often a long search shows what it has found so far
+
+private:
+    struct Request
+    {
+        String queryText;
+        int generation = 0;
+        bool debounce = false;
+    };
+
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    void runSearch(const Request& request);
+    bool isSuperseded(int generation) const { return generation != latestGeneration.load() || threadShouldExit(); }
+    void publish(std::unique_ptr<Results> results);
+
+    LibrarySearchIndex& index;
+    ReadWriteLock& indexLock;
+
+    std::atomic<int> latestGeneration{ 0 };
+
+    CriticalSection requestLock;
+    Request pendingRequest;     // Guarded by requestLock
+    bool hasRequest = false;    // Guarded by requestLock
+
+    CriticalSection resultsLock;
+    std::unique_ptr<Results> pendingResults; // Guarded by resultsLock
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LibrarySearchWorker)
+};
@@ -0,0 +1,289 @@
+#include "LibrarySortOrder.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr uint32 noRank = std::numeric_limits<uint32>::max();
+
+    /** Orders rows by their rank in a column, rows without a value last, ties by row */
+    struct RowOrder
+    {
+        const std::vector<uint32>& ranks;
+        bool forwards;
+
+        /** The row's rank in the sort direction, in the top half, and the row itself underneath */
+        uint64 getSortKey(int row) const
+        {
+            uint32 rank = ranks[(size_t) row];
+
+            if (!forwards && rank != noRank)
+                rank = noRank - 1 - rank;
+
+            return ((uint64) rank << 32) | (uint32) row;
+        }
+
+        bool operator()(int a, int b) const { return getSortKey(a) < getSortKey(b); }
+    };
+
+    template <typename Value>
+    size_t getVectorBytes(const std::vector<Value>& values)
+    {
+        return values.capacity() * sizeof(Value);
+    }
+
+    /** Heap bytes behind a key; short ones live inside the std::string itself */
+    size_t getKeyBytes(const std::string& key)
+    {
+        return key.capacity() > std::string().capacity() ? key.capacity() + 1 : 0;
+    }
+
+    uint64 getPrefix(const std::string& key)
+    {
+        uint64 prefix = 0;
+
+        for (size_t i = 0; i < 8; ++i)
+            prefix = (prefix << 8) | (i < key.size() ? (uint8) key[i] : 0);
+
+        return prefix;
+    }
+}
+
+//==============================================================================
+std::string LibrarySortOrder::makeCollationKey(const String& text)
+{
+    std::string key;
+    key.reserve((size_t) text.getNumBytesAsUTF8() + 4);
+
+    for (auto p = text.toLowerCase().getCharPointer(); !p.isEmpty();)
+    {
+        const juce_wchar c = *p;
+
+        if (c >= '0' && c <= '9')
+        {
+            // A run of digits: drop leading zeros and put the length first, so numbers compare by value
+            auto start = p;
+            while (*start == '0' && start[1] >= '0' && start[1] <= '9')
+                ++start;
+
+            p = start;
+            std::string digits;
+            while (*p >= '0' && *p <= '9')
+                digits += (char) *p++;
+
+            key += '0';
+            key += (char) jmin((int) digits.size(), 255);
+            key += digits;
+        }
+        else
+        {
+            char bytes[8];
+            CharPointer_UTF8 out(bytes);
+            out.write(c);
+            key.append(bytes, (size_t) (out.getAddress() - bytes));
+            ++p;
+        }
+    }
+
+    return key;
+}
+
+void LibrarySortOrder::setText(int columnId, int row, const String& text)
+{
+    auto& column = columns[columnId];
+    jassert(!column.numeric && !column.pooled);
+
+    if ((size_t) row >= column.keys.size())
+    {
+        column.keys.resize((size_t) row + 1);
+        column.prefixes.resize((size_t) row + 1, 0);
+        column.ranksValid = false; // New rows need ranks, even empty ones
+    }
+
+    auto key = makeCollationKey(text);
+
+    // Scanning sets most rows again unchanged; those don't need re-ranking
+    if (key != column.keys[(size_t) row])
+    {
+        column.prefixes[(size_t) row] = getPrefix(key);
+        column.keys[(size_t) row] = std::move(key);
+        column.ranksValid = false;
+    }
+}
+
+void LibrarySortOrder::setPooledText(int columnId, int row, uint32 id, const String& text)
+{
+    auto& column = columns[columnId];
+    jassert(!column.numeric && (column.pooled || column.keys.empty()));
+    column.pooled = true;
+
+    if ((size_t) id >= column.keys.size())
+    {
+        column.keys.resize((size_t) id + 1);
+        column.prefixes.resize((size_t) id + 1, 0);
+    }
+
+    // Each distinct string's key is made once, however many rows share it
+    if (column.keys[(size_t) id].empty() && text.isNotEmpty())
+    {
+        column.keys[(size_t) id] = makeCollationKey(text);
+        column.prefixes[(size_t) id] = getPrefix(column.keys[(size_t) id]);
+    }
+
+    if ((size_t) row >= column.ids.size())
+    {
+        column.ids.resize((size_t) row + 1, 0);
+        column.ranksValid = false;
+    }
+
+    if (column.ids[(size_t) row] != id)
+    {
+        column.ids[(size_t) row] = id;
+        column.ranksValid = false;
+    }
+}
+
+void LibrarySortOrder::setNumber(int columnId, int row, double value)
+{
+    auto& column = columns[columnId];
+    jassert(column.keys.empty());
+    column.numeric = true;
+
+    if ((size_t) row >= column.numbers.size())
+    {
+        column.numbers.resize((size_t) row + 1, std::numeric_limits<double>::quiet_NaN());
+        column.ranksValid = false;
+    }
+
+    auto& number = column.numbers[(size_t) row];
+
+    if (number != value && !(std::isnan(number) && std::isnan(value)))
+    {
+        number = value;
+        column.ranksValid = false;
+    }
+}
+
+void LibrarySortOrder::clear()
+{
+    columns.clear();
+}
+
+void LibrarySortOrder::setSortColumn(int columnId, bool forwards)
+{
+    sortColumnId = columnId;
+    sortForwards = forwards;
+}
+
+//==============================================================================
+void LibrarySortOrder::updateRanks(Column& column)
+{
+    if (column.ranksValid)
+        return;
+
+    const auto& keys = column.keys;
+    const auto& prefixes = column.prefixes;
+    const auto& numbers = column.numbers;
+
+    // Pooled columns rank each distinct string once, then hand the ranks out to the rows
+    const size_t numItems = column.numeric ? numbers.size() : keys.size();
+
+    std::vector<int> order;
+    order.reserve(numItems);
+    for (int item = 0; item < (int) numItems; ++item)
+        if (column.numeric ? !std::isnan(numbers[(size_t) item]) : !keys[(size_t) item].empty())
+            order.push_back(item);
+
+    auto isLess = [&](int a, int b)
+    {
+        if (column.numeric)
+            return numbers[(size_t) a] < numbers[(size_t) b];
+
+        const uint64 prefixA = prefixes[(size_t) a];
+        const uint64 prefixB = prefixes[(size_t) b];
+        return prefixA != prefixB ? prefixA < prefixB : keys[(size_t) a] < keys[(size_t) b];
+    };
+
+    std::sort(order.begin(), order.end(), isLess);
+
+    std::vector<uint32> itemRanks(numItems, noRank);
+    uint32 rank = 0;
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        if (i > 0 && isLess(order[i - 1], order[i]))
+            ++rank;
+
+        itemRanks[(size_t) order[i]] = rank;
+    }
+
+    if (column.pooled)
+    {
+        column.ranks.resize(column.ids.size());
+
+        for (size_t row = 0; row < column.ids.size(); ++row)
+            column.ranks[row] = itemRanks[column.ids[row]];
+    }
+    else
+    {
+        column.ranks = std::move(itemRanks);
+    }
+
+    column.ranksValid = true;
+}
+
+void LibrarySortOrder::sort(std::vector<int>& rows)
+{
+    if (!isSorted())
+        return;
+
+    auto& column = columns[sortColumnId];
+    updateRanks(column);
+    jassert(std::all_of(rows.begin(), rows.end(), [&column](int row) { return (size_t) row < column.ranks.size(); }));
+
+    // Sorting packed integers keeps the comparisons to one load each and the data in cache
+    const RowOrder order{ column.ranks, sortForwards };
+    std::vector<uint64> sortKeys(rows.size());
+
+    for (size_t i = 0; i < rows.size(); ++i)
+        sortKeys[i] = order.getSortKey(rows[i]);
+
+    std::sort(sortKeys.begin(), sortKeys.end());
+
+    for (size_t i = 0; i < rows.size(); ++i)
+        rows[i] = (int) (uint32) sortKeys[i];
+}
+
+void LibrarySortOrder::merge(std::vector<int>& sortedRows, std::vector<int> newRows)
+{
+    if (newRows.empty())
+        return;
+
+    sort(newRows);
+
+    const auto middle = (std::ptrdiff_t) sortedRows.size();
+    sortedRows.insert(sortedRows.end(), newRows.begin(), newRows.end());
+
+    if (isSorted())
+    {
+        const RowOrder order{ columns[sortColumnId].ranks, sortForwards };
+        std::inplace_merge(sortedRows.begin(), sortedRows.begin() + middle, sortedRows.end(), order);
+    }
+}
+
+size_t LibrarySortOrder::getMemoryUsage() const
+{
+    size_t bytes = 0;
+
+    for (const auto& entry : columns)
+    {
+        const auto& column = entry.second;
+        bytes += getVectorBytes(column.numbers) + getVectorBytes(column.keys) + getVectorBytes(column.prefixes)
+               + getVectorBytes(column.ids) + getVectorBytes(column.ranks);
+
+        for (const auto& key : column.keys)
+            bytes += getKeyBytes(key);
+    }
+
+    return bytes;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <map>
+#include <string>
+#include <vector>
+
+//==============================================================================
+/**
+ * Sort keys for the library table's columns, and the order they're sorted in.
+ *
+ * A text column keeps one collation key per row. Keys are built once, when the
+ * row is set: lower-cased UTF-8 with each run of digits rewritten so that a
+ * plain byte comparison gives natural, case-insensitive order ("Track 2"
+ * before "track 10"). A pooled column, for text the model interns, keeps one
+ * key per distinct string and just the string's id per row, and is ranked by
+ * distinct string. Numeric columns keep their values.
+ *
+ * The first time a column is sorted after a change, its rows are ranked by
+ * key. Sorting rows after that is a sort of 64-bit integers, each holding a
+ * row's rank and the row number, so no strings are compared at all.
+ *
+ * Rows with no value (empty text, NaN) go last in either direction. Ties keep
+ * library order, so a sort is stable and the same rows always come out the
+ * same way.
+ */
+class LibrarySortOrder
+{
+public:
+    /** Set a row's text in a column. Empty text has no value. */
+    void setText(int columnId, int row, const String& text);
+
+    /**
+     * Set a row's text in a pooled column, where id identifies the text: rows
+     * with equal ids share one key. The text is only read the first time its id
+     * is seen, so an id must keep meaning the same text until clear(). Id 0 is
+     * the empty string.
+     */
+    void setPooledText(int columnId, int row, uint32 id, const String& text);
+
+    /** Set a row's number in a column. NaN has no value. */
+    void setNumber(int columnId, int row, double value);
+
+    /** Forget every row's keys. The sort column stays. */
+    void clear();
+
+    /** Sort by this column from now on, or by nothing if columnId is 0. */
+    void setSortColumn(int columnId, bool forwards);
+
+    int getSortColumn() const { return sortColumnId; }
+    bool isSorted() const { return sortColumnId != 0; }
+
+    /** Put the rows in the current sort order. Every row must have been set in the sort column. */
+    void sort(std::vector<int>& rows);
+
+    /** Add rows to a list already in the current sort order, keeping it in order. */
+    void merge(std::vector<int>& sortedRows, std::vector<int> newRows);
+
+    /** Byte string that compares in natural, case-insensitive order. */
+    static std::string makeCollationKey(const String& text);
+
+    /** Bytes held by the keys and ranks of every column. */
+    size_t getMemoryUsage() const;
+
+private:
+    struct Column
+    {
+        bool numeric = false;
+        bool pooled = false;           // Keys are per id rather than per row
+        std::vector<double> numbers;   // Numeric columns: NaN if no value
+        std::vector<std::string> keys; // Text columns: per row, or per id if pooled; empty if no value
+        std::vector<uint64> prefixes;  // First eight bytes of each key, big-endian, to compare most keys in one go
+        std::vector<uint32> ids;       // Pooled columns: each row's id
+        std::vector<uint32> ranks;     // Position of each row's key in order; equal keys share a rank
+        bool ranksValid = false;
+    };
+
+    void updateRanks(Column& column);
+
+    std::map<int, Column> columns;
+    int sortColumnId = 0;
+    bool sortForwards = true;
+};
@@ -0,0 +1,243 @@
+#include "LoudnessAnalyser.h"
+#include <vector>
+
+//==============================================================================
+void KWeightingFilter::prepare(double sampleRate)
+{
+    // Stage 1: high shelf, +4 dB above ~1.7 kHz (BS.1770 coefficients re-derived for sampleRate)
+    {
+        const double f0 = 1681.974450955533;
+        const double gainDb = 3.999843853973347;
+        const double q = 0.7071752369554196;
+        const double k = std::tan(MathConstants<double>::pi * f0 / sampleRate);
+        const double vh = std::pow(10.0, gainDb / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+
+        shelf.setCoefficients(IIRCoefficients(vh + vb * k / q + k * k,
+                                              2.0 * (k * k - vh),
+                                              vh - vb * k / q + k * k,
+                                              1.0 + k / q + k * k,
+                                              2.0 * (k * k - 1.0),
+                                              1.0 - k / q + k * k));
+    }
+
+    // Stage 2: RLB high-pass at ~38 Hz
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+        const double k = std::tan(MathConstants<double>::pi * f0 / sampleRate);
+
+        highPass.setCoefficients(IIRCoefficients(1.0, -2.0, 1.0,
+                                                 1.0 + k / q + k * k,
+                                                 2.0 * (k * k - 1.0),
+                                                 1.0 - k / q + k * k));
+    }
+
+    reset();
+}
+
+void KWeightingFilter::reset()
+{
+    shelf.reset();
+    highPass.reset();
+}
+
+void KWeightingFilter::process(float* samples, int numSamples)
+{
+    shelf.processSamples(samples, numSamples);
+    highPass.processSamples(samples, numSamples);
+}
+
+//==============================================================================
+double LoudnessKernels::sumOfSquares(const float* samples, int numSamples)
+{
+    using Vec = dsp::SIMDRegister<float>;
+    double total = 0.0;
+
+    // Scalar prologue up to the first SIMD-aligned sample
+    while (numSamples > 0 && !Vec::isSIMDAligned(samples))
+    {
+        total += (double) *samples * *samples;
+        ++samples;
+        --numSamples;
+    }
+
+    constexpr int lanes = (int) Vec::SIMDNumElements;
+    auto acc = Vec::expand(0.0f);
+
+    for (; numSamples >= lanes; numSamples -= lanes, samples += lanes)
+    {
+        const auto v = Vec::fromRawArray(samples);
+        acc += v * v;
+    }
+
+    total += acc.sum();
+
+    for (int i = 0; i < numSamples; ++i)
+        total += (double) samples[i] * samples[i];
+
+    return total;
+}
+
+float LoudnessKernels::absolutePeak(const float* samples, int numSamples)
+{
+    if (numSamples <= 0)
+        return 0.0f;
+
+    const auto range = FloatVectorOperations::findMinAndMax(samples, numSamples);
+    return jmax(-range.getStart(), range.getEnd());
+}
+
+//==============================================================================
+namespace
+{
+    /**
+     * 4x polyphase interpolator for true-peak detection. Each phase is a
+     * Hann-windowed sinc, applied one tap at a time across the whole block
+     * with FloatVectorOperations so the inner loop stays vectorised.
+     */
+    class TruePeakDetector
+    {
+    public:
+        TruePeakDetector()
+        {
+            for (int phase = 1; phase < numPhases; ++phase)
+            {
+                const double centre = numTaps / 2 - 1 + phase / (double) numPhases;
+                double sum = 0.0;
+
+                for (int k = 0; k < numTaps; ++k)
+                {
+                    const double x = k - centre;
+                    const double sinc = x == 0.0 ? 1.0 : std::sin(MathConstants<double>::pi * x) / (MathConstants<double>::pi * x);
+                    const double window = 0.5 * (1.0 + std::cos(MathConstants<double>::pi * x / (numTaps / 2)));
+                    coeffs[phase][k] = (float) (sinc * window);
+                    sum += coeffs[phase][k];
+                }
+
+                for (int k = 0; k < numTaps; ++k)
+                    coeffs[phase][k] = (float) (coeffs[phase][k] / sum);
+            }
+
+            history.resize(numTaps - 1, 0.0f);
+        }
+
+        float process(const float* samples, int numSamples)
+        {
+            input.resize((size_t) (numSamples + numTaps - 1));
+            output.resize((size_t) numSamples);
+
+            std::copy(history.begin(), history.end(), input.begin());
+            std::copy(samples, samples + numSamples, input.begin() + (numTaps - 1));
+
+            float peak = LoudnessKernels::absolutePeak(samples, numSamples);
+
+            for (int phase = 1; phase < numPhases; ++phase)
+            {
+                FloatVectorOperations::clear(output.data(), numSamples);
+
+                for (int k = 0; k < numTaps; ++k)
+                    FloatVectorOperations::addWithMultiply(output.data(), input.data() + k, coeffs[phase][k], numSamples);
+
+                peak = jmax(peak, LoudnessKernels::absolutePeak(output.data(), numSamples));
+            }
+
+            std::copy(input.end() - (numTaps - 1), input.end(), history.begin());
+            return peak;
+        }
+
+    private:
+        static constexpr int numTaps = 12;
+        static constexpr int numPhases = 4;
+
+        float coeffs[numPhases][numTaps] = {};
+        std::vector<float> history, input, output;
+    };
+}
+
+//==============================================================================
+LoudnessAnalyser::Result LoudnessAnalyser::analyse(AudioFormatReader& reader, const std::function<bool()>& shouldStop)
+{
+    Result result;
+
+    if (reader.sampleRate <= 0.0 || reader.lengthInSamples <= 0 || reader.numChannels == 0)
+        return result;
+
+    const int numChannels = jmin(2, (int) reader.numChannels);
+    const int subBlockSize = roundToInt(reader.sampleRate * 0.1); // 100 ms gating step
+
+    AudioBuffer<float> buffer(numChannels, subBlockSize);
+    KWeightingFilter filters[2];
+    TruePeakDetector peakDetectors[2];
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        filters[ch].prepare(reader.sampleRate);
+
+    std::vector<double> subBlockPower; // Channel-summed mean square per 100 ms step
+    subBlockPower.reserve((size_t) (reader.lengthInSamples / subBlockSize + 1));
+    float peak = 0.0f;
+
+    for (int64 pos = 0; pos < reader.lengthInSamples; pos += subBlockSize)
+    {
+        if (shouldStop != nullptr && shouldStop())
+            return {};
+
+        const int numSamples = (int) jmin((int64) subBlockSize, reader.lengthInSamples - pos);
+        reader.read(&buffer, 0, numSamples, pos, true, numChannels > 1);
+
+        double power = 0.0;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* data = buffer.getWritePointer(ch);
+            peak = jmax(peak, peakDetectors[ch].process(data, numSamples));
+            filters[ch].process(data, numSamples);
+            power += LoudnessKernels::sumOfSquares(data, numSamples);
+        }
+
+        if (numSamples == subBlockSize) // A trailing partial step is too short to gate
+            subBlockPower.push_back(power / subBlockSize);
+    }
+
+    result.truePeakDb = Decibels::gainToDecibels(peak, -100.0f);
+
+    // 400 ms gating blocks with 75% overlap
+    std::vector<double> blocks;
+    for (size_t i = 3; i < subBlockPower.size(); ++i)
+        blocks.push_back((subBlockPower[i - 3] + subBlockPower[i - 2] + subBlockPower[i - 1] + subBlockPower[i]) * 0.25);
+
+    if (blocks.empty())
+        return result;
+
+    auto gatedMean = [&blocks](double threshold)
+    {
+        double sum = 0.0;
+        int count = 0;
+        for (auto power : blocks)
+        {
+            if (power > threshold)
+            {
+                sum += power;
+                ++count;
+            }
+        }
+        return count > 0 ? sum / count : 0.0;
+    };
+
+    const double absoluteGate = std::pow(10.0, (-70.0 + 0.691) / 10.0);
+    const double ungated = gatedMean(absoluteGate);
+
+    if (ungated <= 0.0)
+        return result;
+
+    const double relativeGate = ungated * std::pow(10.0, -10.0 / 10.0);
+    result.integratedLufs = LoudnessKernels::meanSquareToLufs(gatedMean(jmax(absoluteGate, relativeGate)));
+    result.valid = true;
+    return result;
+}
+
+float LoudnessAnalyser::getNormalisationGainDb(float integratedLufs, float truePeakDb)
+{
+    const float gainDb = jmin(targetLufs - integratedLufs, -1.0f - truePeakDb); // Keep 1 dB of true-peak headroom
+    return jlimit(-12.0f, 12.0f, gainDb);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/**
+ * Two-stage K-weighting pre-filter from ITU-R BS.1770 (high shelf followed by
+ * the RLB high-pass), with coefficients derived for any sample rate.
+ */
+class KWeightingFilter
+{
+public:
+    void prepare(double sampleRate);
+    void reset();
+
+    /** Filter a block of samples in place. */
+    void process(float* samples, int numSamples);
+
+private:
+    IIRFilter shelf;
+    IIRFilter highPass;
+};
+
+//==============================================================================
+/** Vectorised helpers shared by the offline analyser and the real-time meter. */
+namespace LoudnessKernels
+{
+    /** Sum of x[i]^2 over the block, using SIMD registers for the aligned body. */
+    double sumOfSquares(const float* samples, int numSamples);
+
+    /** Largest absolute sample value in the block. */
+    float absolutePeak(const float* samples, int numSamples);
+
+    /** Convert a channel-summed mean square to LUFS. */
+    inline float meanSquareToLufs(double meanSquare)
+    {
+        return meanSquare > 0.0 ? (float) (-0.691 + 10.0 * std::log10(meanSquare)) : -100.0f;
+    }
+}
+
+//==============================================================================
+/**
+ * Offline EBU R128 analysis of a whole file: gated integrated loudness and
+ * 4x oversampled true peak. Run from the library scanner, never on the audio thread.
+ */
+class LoudnessAnalyser
+{
+public:
+    struct Result
+    {
+        float integratedLufs = -100.0f;
+        float truePeakDb = -100.0f;
+        bool valid = false;
+    };
+
+    /** Decode the reader from start to end and measure it. Gives up with an invalid result as soon as shouldStop returns true. */
+    static Result analyse(AudioFormatReader& reader, const std::function<bool()>& shouldStop = nullptr);
+
+    /** Loudness target used for automatic gain on load. */
+    static constexpr float targetLufs = -14.0f;
+
+    /** Gain offset in dB that brings a track to the target without pushing its true peak above -1 dBTP. */
+    static float getNormalisationGainDb(float integratedLufs, float truePeakDb);
+};
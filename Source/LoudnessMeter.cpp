@@ -0,0 +1,73 @@
+#include "LoudnessMeter.h"
+
+void LoudnessMeter::prepare(double sampleRate, int maximumBlockSize)
+{
+    for (auto& filter : filters)
+        filter.prepare(sampleRate);
+
+    scratch.setSize(numChannels, jmax(1, maximumBlockSize));
+    subBlockSize = jmax(1, roundToInt(sampleRate * 0.1));
+    reset();
+}
+
+void LoudnessMeter::reset()
+{
+    for (auto& filter : filters)
+        filter.reset();
+
+    subBlockFill = 0;
+    subBlockSum = 0.0;
+    historyIndex = 0;
+    std::fill(std::begin(history), std::end(history), 0.0);
+
+    momentaryLufs = -100.0f;
+    shortTermLufs = -100.0f;
+}
+
+void LoudnessMeter::process(const AudioSourceChannelInfo& block)
+{
+    if (subBlockSize == 0)
+        return;
+
+    const int channelsToMeasure = jmin(numChannels, block.buffer->getNumChannels());
+    int done = 0;
+
+    // Work in pieces that fit both the scratch buffer and the current 100 ms step
+    while (done < block.numSamples)
+    {
+        const int num = jmin(block.numSamples - done, scratch.getNumSamples(), subBlockSize - subBlockFill);
+
+        for (int ch = 0; ch < channelsToMeasure; ++ch)
+        {
+            auto* data = scratch.getWritePointer(ch);
+            FloatVectorOperations::copy(data, block.buffer->getReadPointer(ch, block.startSample + done), num);
+            filters[ch].process(data, num);
+            subBlockSum += LoudnessKernels::sumOfSquares(data, num);
+        }
+
+        done += num;
+        subBlockFill += num;
+
+        if (subBlockFill == subBlockSize)
+            finishSubBlock();
+    }
+}
+
+void LoudnessMeter::finishSubBlock()
+{
+    history[historyIndex] = subBlockSum / subBlockSize;
+    historyIndex = (historyIndex + 1) % shortTermSubBlocks;
+    subBlockSum = 0.0;
+    subBlockFill = 0;
+
+    double momentary = 0.0;
+    for (int i = 1; i <= 4; ++i)
+        momentary += history[(historyIndex - i + shortTermSubBlocks) % shortTermSubBlocks];
+
+    double shortTerm = 0.0;
+    for (auto power : history)
+        shortTerm += power;
+
+    momentaryLufs.store(LoudnessKernels::meanSquareToLufs(momentary / 4.0), std::memory_order_relaxed);
+    shortTermLufs.store(LoudnessKernels::meanSquareToLufs(shortTerm / shortTermSubBlocks), std::memory_order_relaxed);
+}
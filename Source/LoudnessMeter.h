@@ -0,0 +1,101 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LoudnessAnalyser.h"
+#include <atomic>
+
+//==============================================================================
+/**
+ * Real-time EBU R128 momentary (400 ms) and short-term (3 s) loudness.
+ * process() runs on the audio thread and never allocates; the readings are
+ * published through atomics for the GUI to poll.
+ */
+class LoudnessMeter
+{
+public:
+    void prepare(double sampleRate, int maximumBlockSize);
+    void reset();
+
+    /** Measure (without modifying) the active region of the block. */
+    void process(const AudioSourceChannelInfo& block);
+
+    float getMomentaryLoudness() const { return momentaryLufs.load(std::memory_order_relaxed); }
+    float getShortTermLoudness() const { return shortTermLufs.load(std::memory_order_relaxed); }
+
+private:
+    void finishSubBlock();
+
+    static constexpr int numChannels = 2;
+    static constexpr int shortTermSubBlocks = 30; // 3 s of 100 ms steps
+
+    KWeightingFilter filters[numChannels];
+    AudioBuffer<float> scratch; // K-weighted copy of the incoming block
+
+    int subBlockSize = 0;
+    int subBlockFill = 0;
+    double subBlockSum = 0.0;
+
+    double history[shortTermSubBlocks] = {};
+    int historyIndex = 0;
+
+    std::atomic<float> momentaryLufs{ -100.0f };
+    std::atomic<float> shortTermLufs{ -100.0f };
+};
+
+//==============================================================================
+/** Vertical bar showing a LoudnessMeter's momentary reading, refreshed on a timer. */
+class LoudnessMeterComponent : public Component, private Timer
+{
+public:
+    LoudnessMeterComponent(const LoudnessMeter& meterToShow, Colour barColour = Colours::springgreen)
+        : meter(meterToShow), barColour(barColour)
+    {
+        startTimerHz(15);
+    }
+
+    ~LoudnessMeterComponent() override
+    {
+        stopTimer();
+    }
+
+    void paint(Graphics& g) override
+    {
+        auto bounds = getLocalBounds().toFloat();
+        auto textArea = bounds.removeFromBottom(14.0f);
+
+        g.setColour(Colours::black);
+        g.fillRect(bounds);
+
+        // -40 LUFS at the bottom, 0 LUFS at the top
+        const float proportion = jlimit(0.0f, 1.0f, (displayedLufs + 40.0f) / 40.0f);
+        g.setColour(displayedLufs > LoudnessAnalyser::targetLufs ? Colours::orange : barColour);
+        g.fillRect(bounds.withTop(bounds.getBottom() - bounds.getHeight() * proportion));
+
+        // Target line
+        const float targetY = bounds.getBottom() - bounds.getHeight() * (LoudnessAnalyser::targetLufs + 40.0f) / 40.0f;
+        g.setColour(Colours::white.withAlpha(0.6f));
+        g.drawHorizontalLine(roundToInt(targetY), bounds.getX(), bounds.getRight());
+
+        g.setColour(Colours::white);
+        g.setFont(10.0f);
+        g.drawText(displayedLufs > -99.0f ? String(displayedLufs, 1) : String("-inf"),
+            textArea, Justification::centred, false);
+    }
+
+private:
+    void timerCallback() override
+    {
+        const float lufs = meter.getMomentaryLoudness();
+        if (std::abs(lufs - displayedLufs) > 0.05f)
+        {
+            displayedLufs = lufs;
+            repaint();
+        }
+    }
+
+    const LoudnessMeter& meter;
+    Colour barColour;
+    float displayedLufs = -100.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoudnessMeterComponent)
+};
@@ -10,6 +10,8 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "MainComponent.h"
+#include "RenderBenchmark.h"
+#include "TagBenchmark.h"
 
 //==============================================================================
 class OtoDecksApplication  : public JUCEApplication
@@ -26,6 +28,25 @@ public:
     {
         // This method is where you should put your application's initialisation code..
 
+        // Headless benchmarks for CI: print the timings and exit without opening a window
+        const StringArray args = getCommandLineParameterArray();
+        const int benchmarkFlag = args.indexOf ("--render-benchmark");
+        if (benchmarkFlag >= 0)
+        {
+            const String audioFile = args[benchmarkFlag + 1].startsWith ("--") ? String() : args[benchmarkFlag + 1];
+            setApplicationReturnValue (RenderBenchmark::run (audioFile));
+            quit();
+            return;
+        }
+
+        const int tagBenchmarkFlag = args.indexOf ("--tag-benchmark");
+        if (tagBenchmarkFlag >= 0)
+        {
+            setApplicationReturnValue (TagBenchmark::run (args[tagBenchmarkFlag + 1]));
+            quit();
+            return;
+        }
+
         mainWindow.reset (new MainWindow (getApplicationName()));
 
     }
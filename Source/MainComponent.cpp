@@ -7,28 +7,44 @@
 */
 
 #include "MainComponent.h"
+#include "GlobalStateManager.h"
 
 //==============================================================================
 MainComponent::MainComponent() :
     mixSlider(juce::Slider::LinearHorizontal, juce::Slider::TextBoxBelow),
     player1(formatManager),
-    deckGUI1(&player1, formatManager, thumbCache, playerIndex1,
+    deckGUI1(&player1, formatManager, waveformCache, playerIndex1,
         juce::Colours::black, juce::Colours::springgreen,
         juce::Colours::springgreen, juce::Colours::black,
         juce::Colours::springgreen, juce::Colours::springgreen,
         juce::Colours::springgreen),
     player2(formatManager),
-    deckGUI2(&player2, formatManager, thumbCache, playerIndex2,
+    deckGUI2(&player2, formatManager, waveformCache, playerIndex2,
         juce::Colours::black, juce::Colours::dodgerblue,
         juce::Colours::dodgerblue, juce::Colours::black,
         juce::Colours::dodgerblue, juce::Colours::dodgerblue,
         juce::Colours::dodgerblue),
-    musicLibrary(deckGUI1, deckGUI2)
+    musicLibrary(deckGUI1, deckGUI2, autoMix, previewPlayer)
 {
 
     // Set the size of the component after adding child components
     setSize(800, 600);
 
+    // Add audio sources to the mixer before the device starts pulling from it
+    mixerSource.addInputSource(&player1);
+    mixerSource.addInputSource(&player2);
+    mixerSource.setParallelProcessingEnabled(GlobalStateManager::getInstance().getBoolSetting("parallelDecks", false));
+
+    // Keep the deck displays in step with tracks automix loads behind their backs
+    autoMix.onTrackLoaded = [this](int deckIndex, const AutoMixEngine::Track& track)
+    {
+        (deckIndex == 1 ? deckGUI1 : deckGUI2).displayLoadedFile(track.filePath);
+    };
+
+    // PFL buttons route each deck to the cue outputs as well as the master
+    deckGUI1.onCueToggled = [this](bool on) { mixerSource.setInputCueEnabled(0, on); };
+    deckGUI2.onCueToggled = [this](bool on) { mixerSource.setInputCueEnabled(1, on); };
+
     // Request permission to record audio if needed
     if (RuntimePermissions::isRequired(RuntimePermissions::recordAudio)
         && !RuntimePermissions::isGranted(RuntimePermissions::recordAudio))
@@ -36,13 +52,13 @@ MainComponent::MainComponent() :
         RuntimePermissions::request(RuntimePermissions::recordAudio,
             [&](bool granted) {
                 if (granted)
-                    setAudioChannels(2, 2);
+                    setAudioChannels(2, 4);
             });
     }
     else
     {
-        // Specify the number of output channels
-        setAudioChannels(0, 2);
+        // Specify the number of output channels: master on 1/2, headphone cue and library preview on 3/4
+        setAudioChannels(0, 4);
     }
 
     // Initialize the mix slider properties
@@ -52,11 +68,25 @@ MainComponent::MainComponent() :
     mixSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
     mixSlider.setDoubleClickReturnValue(true, 15.0);
 
+    // Initialize the cue blend: fully left hears only the PFL decks, fully right only the master
+    cueMixSlider.addListener(this);
+    cueMixSlider.setRange(0.0, 1.0);
+    cueMixSlider.setValue(0.0, dontSendNotification);
+    cueMixSlider.setDoubleClickReturnValue(true, 0.5);
+    cueMixSlider.setTooltip("Headphones: cue / master");
+
     // Make child components visible
     addAndMakeVisible(deckGUI1);
     addAndMakeVisible(deckGUI2);
     addAndMakeVisible(mixSlider);
+    addAndMakeVisible(masterLoudnessDisplay);
+    addAndMakeVisible(masterLevelDisplay);
+    addAndMakeVisible(masterSpectrum);
+    addAndMakeVisible(cueMixSlider);
     addAndMakeVisible(musicLibrary);
+    addChildComponent(paintProfilerOverlay);
+    paintProfilerOverlay.setActive(GlobalStateManager::getInstance().getBoolSetting("showPaintProfiler", false));
+    setWantsKeyboardFocus(true);
     // Register basic audio formats
     formatManager.registerBasicFormats();
 }
@@ -65,34 +95,55 @@ MainComponent::~MainComponent()
 {
     // Shut down the audio device and clear the audio source
     shutdownAudio();
+    mixerSource.setParallelProcessingEnabled(false);
 }
 
 //==============================================================================
 void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-    // Prepare audio players for playback
-    player1.prepareToPlay(samplesPerBlockExpected, sampleRate);
-    player2.prepareToPlay(samplesPerBlockExpected, sampleRate);
-
-    // Prepare the mixer source
+    // Prepare the mixer source, which prepares each deck's player in turn
     mixerSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
-
-    // Add audio sources to the mixer
-    mixerSource.addInputSource(&player1, false);
-    mixerSource.addInputSource(&player2, false);
+    masterLoudness.prepare(sampleRate, samplesPerBlockExpected);
+    masterTap.prepare(sampleRate);
+    autoMix.prepareToPlay(sampleRate);
+    previewPlayer.prepareToPlay(sampleRate);
 }
 
 void MainComponent::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
 {
+    // Let automix start the next deck on this block if a transition is due
+    autoMix.audioBlockStarting(bufferToFill.numSamples);
+
+    auto& output = *bufferToFill.buffer;
+
+    // Master on outputs 1/2 and cue on 3/4. These views point at the device's own channel
+    // data, so the mixer sums each deck straight into them without an intermediate copy
+    AudioBuffer<float> master(output.getArrayOfWritePointers(), jmin(2, output.getNumChannels()),
+        bufferToFill.startSample, bufferToFill.numSamples);
+    AudioSourceChannelInfo masterInfo(&master, 0, bufferToFill.numSamples);
+
+    const bool hasCueOutputs = output.getNumChannels() >= 4;
+    AudioBuffer<float> cue;
+    if (hasCueOutputs)
+        cue.setDataToReferTo(output.getArrayOfWritePointers() + 2, 2, bufferToFill.startSample, bufferToFill.numSamples);
+    AudioSourceChannelInfo cueInfo(&cue, 0, bufferToFill.numSamples);
+
     // Fill the audio buffer with the next audio block from the mixer
-    mixerSource.getNextAudioBlock(bufferToFill);
+    mixerSource.getNextAudioBlock(masterInfo, hasCueOutputs ? &cueInfo : nullptr);
+    masterLoudness.process(masterInfo);
+    masterTap.process(masterInfo);
+
+    // The library preview is only ever heard in the headphones
+    if (hasCueOutputs)
+        previewPlayer.addNextBlock(output, 2, bufferToFill.startSample, bufferToFill.numSamples);
+
+    for (int chan = hasCueOutputs ? 4 : 2; chan < output.getNumChannels(); ++chan)
+        output.clear(chan, bufferToFill.startSample, bufferToFill.numSamples);
 }
 
 void MainComponent::releaseResources()
 {
     // Release resources when the audio device stops or restarts
-    player1.releaseResources();
-    player2.releaseResources();
     mixerSource.releaseResources();
 }
 
@@ -119,8 +170,12 @@ void MainComponent::resized()
 
     FlexBox mixBox;
     mixBox.flexDirection = FlexBox::Direction::row;
-    mixBox.items.add(FlexItem().withFlex(2));
+    mixBox.items.add(FlexItem().withFlex(1));
+    mixBox.items.add(FlexItem(masterSpectrum).withFlex(1).withHeight(50));
     mixBox.items.add(FlexItem(mixSlider).withFlex(1).withHeight(50));
+    mixBox.items.add(FlexItem(masterLevelDisplay).withWidth(16).withHeight(50));
+    mixBox.items.add(FlexItem(masterLoudnessDisplay).withWidth(40).withHeight(50));
+    mixBox.items.add(FlexItem(cueMixSlider).withWidth(50).withHeight(50));
     mixBox.items.add(FlexItem().withFlex(2));
 
     // Add layout items to the main box
@@ -130,10 +185,42 @@ void MainComponent::resized()
 
     // Perform the layout based on the current component bounds
     mainBox.performLayout(getLocalBounds().toFloat());
+
+    // The profiler sits over the top-right corner, above everything else
+    paintProfilerOverlay.setBounds(getLocalBounds().removeFromTop(PaintProfilerOverlay::preferredHeight)
+        .removeFromRight(PaintProfilerOverlay::preferredWidth));
+    paintProfilerOverlay.toFront(false);
+}
+
+bool MainComponent::keyPressed(const KeyPress& key)
+{
+    if (key == KeyPress('p', ModifierKeys::commandModifier | ModifierKeys::shiftModifier, 0))
+    {
+        const bool show = !paintProfilerOverlay.isVisible();
+        paintProfilerOverlay.setActive(show);
+        GlobalStateManager::getInstance().setBoolSetting("showPaintProfiler", show);
+        return true;
+    }
+
+    if (key == KeyPress('d', ModifierKeys::commandModifier | ModifierKeys::shiftModifier, 0))
+    {
+        const bool parallel = !mixerSource.isParallelProcessingEnabled();
+        mixerSource.setParallelProcessingEnabled(parallel);
+        GlobalStateManager::getInstance().setBoolSetting("parallelDecks", parallel);
+        return true;
+    }
+
+    return false;
 }
 
 void MainComponent::sliderValueChanged(Slider* slider)
 {
+    if (slider == &cueMixSlider)
+    {
+        mixerSource.setCueMasterMix((float) cueMixSlider.getValue());
+        return;
+    }
+
     // Update deck GUI mix values based on slider changes
     DBG("sliderValueChanged");
     deckGUI2.setmix(mixSlider.getValue());
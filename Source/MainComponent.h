@@ -11,6 +11,13 @@
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "DJAudioPlayer.h"
 #include "DeckGUI.h"
+#include "ParallelMixerAudioSource.h"
+#include "LoudnessMeter.h"
+#include "LevelMeter.h"
+#include "PaintProfiler.h"
+#include "AutoMixEngine.h"
+#include "PreviewPlayer.h"
+#include "WaveformCache.h"
 
 //==============================================================================
 /**
@@ -35,6 +42,7 @@ public:
     //==============================================================================
     void paint(Graphics& g) override; // Render the component's graphics
     void resized() override; // Handle component resizing
+    bool keyPressed(const KeyPress& key) override; // Ctrl/Cmd+Shift+P toggles the paint profiler, +D parallel decks
 
 private:
     //==============================================================================
@@ -42,27 +50,41 @@ private:
     int playerIndex1{ 1 }; // Index for player 1
     int playerIndex2{ 2 }; // Index for player 2
     AudioFormatManager formatManager; // Manages audio file formats
-    AudioThumbnailCache thumbCache{ 100 }; // Cache for audio thumbnails
+    WaveformCache waveformCache; // Analysed waveforms kept on disk between sessions
 
     // Create audio player instances for each deck
     DJAudioPlayer player1{ formatManager };
-    DeckGUI deckGUI1{ &player1, formatManager, thumbCache, playerIndex1,
+    DeckGUI deckGUI1{ &player1, formatManager, waveformCache, playerIndex1,
                       Colours::black, Colours::springgreen,
                       Colours::springgreen, Colours::black,
                       Colours::springgreen, Colours::springgreen,
                       Colours::springgreen };
 
     DJAudioPlayer player2{ formatManager };
-    DeckGUI deckGUI2{ &player2, formatManager, thumbCache, playerIndex2,
+    DeckGUI deckGUI2{ &player2, formatManager, waveformCache, playerIndex2,
                       Colours::black, Colours::dodgerblue,
                       Colours::dodgerblue, Colours::black,
                       Colours::dodgerblue, Colours::dodgerblue,
                       Colours::dodgerblue };
     
-    MusicLibrary musicLibrary{ deckGUI1 ,deckGUI2 };
+    AutoMixEngine autoMix{ formatManager, player1, player2 }; // Queue playback across both decks
 
-    MixerAudioSource mixerSource; // Mixer for combining audio sources
+    PreviewPlayer previewPlayer{ formatManager }; // Library audition on outputs 3/4
+
+    MusicLibrary musicLibrary{ deckGUI1 ,deckGUI2, autoMix, previewPlayer };
+
+    ParallelMixerAudioSource mixerSource; // Mixer for combining audio sources, optionally one deck per core (Ctrl+Shift+D)
     Slider mixSlider{}; // Slider to control audio mix level
+    Slider cueMixSlider{ Slider::RotaryVerticalDrag, Slider::NoTextBox }; // Headphone cue/master blend
+
+    LoudnessMeter masterLoudness; // Loudness of the final mix, measured on the audio thread
+    LoudnessMeterComponent masterLoudnessDisplay{ masterLoudness, Colours::white };
+
+    MeterTap masterTap; // Master peak/RMS and spectrum feed, filled on the audio thread
+    LevelMeterComponent masterLevelDisplay{ masterTap, Colours::white };
+    SpectrumComponent masterSpectrum{ masterTap, Colours::white.withAlpha(0.7f) };
+
+    PaintProfilerOverlay paintProfilerOverlay; // Ctrl+Shift+P: paint counts and times per component
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent) // Prevent copying and memory leaks
 };
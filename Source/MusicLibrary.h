@@ -1,24 +1,45 @@
 #pragma once
 
 #include <JuceHeader.h>
-
-struct MusicEntry
-{
-    juce::String title;
-    juce::String artist;
-    juce::String album;
-    juce::String duration;
-    juce::String filePath;
-};
+#include "LoudnessAnalyser.h"
+#include "AutoMixEngine.h"
+#include "PreviewPlayer.h"
+#include "PaintProfiler.h"
+#include "LibraryScanner.h"
+#include "LibraryDatabase.h"
+#include "LibraryModel.h"
+#include "FolderWatcher.h"
+#include "LibraryImporter.h"
+#include "LibrarySearchIndex.h"
+#include "LibrarySearchWorker.h"
+#include "LibrarySortOrder.h"
+#include "GlobalStateManager.h"
 
 class MusicLibrary : public juce::Component,
     public juce::TableListBoxModel,
     private juce::TextEditor::Listener,
     private juce::Button::Listener,
+    private juce::Timer,
     public juce::FileDragAndDropTarget // Add this
 {
 public:
-    MusicLibrary(DeckGUI& deck1, DeckGUI& deck2) : deckGUI1(deck1), deckGUI2(deck2)
+    /** What the library keeps in step with besides its database. The render benchmark turns it all off */
+    struct Options
+    {
+        juce::File databaseFile = LibraryDatabase::getDefaultFile();
+        bool watchFolders = true;         // Follow the folders added with Add Folder
+        bool scanFiles = true;            // Read tags, length and loudness of tracks not yet scanned
+        bool importLegacyFileList = true; // Seed a new database from MusicLibraryFileList.txt
+    };
+
+    MusicLibrary(DeckGUI& deck1, DeckGUI& deck2, AutoMixEngine& autoMixToUse, PreviewPlayer& previewToUse)
+        : MusicLibrary(deck1, deck2, autoMixToUse, previewToUse, Options())
+    {
+    }
+
+    MusicLibrary(DeckGUI& deck1, DeckGUI& deck2, AutoMixEngine& autoMixToUse, PreviewPlayer& previewToUse, const Options& optionsToUse)
+        : options(optionsToUse), database(options.databaseFile, options.importLegacyFileList),
+          deckGUI1(deck1), deckGUI2(deck2), autoMix(autoMixToUse), preview(previewToUse)
     {
 
         // Register audio formats
@@ -44,35 +65,87 @@ public:
         addToDeck2Button.addListener(this);
 
 
+        addAndMakeVisible(queueButton);
+        queueButton.setButtonText("Queue");
+        queueButton.addListener(this);
+
+        addAndMakeVisible(previewButton);
+        previewButton.setButtonText("Preview");
+        previewButton.setClickingTogglesState(true);
+        previewButton.addListener(this);
+
+        addAndMakeVisible(autoMixButton);
+        autoMixButton.setButtonText("Automix");
+        autoMixButton.addListener(this);
+        autoMix.onDisabled = [this] { autoMixButton.setToggleState(false, juce::dontSendNotification); };
+
         addAndMakeVisible(clearButton);
         clearButton.setButtonText("Clear Library");
         clearButton.addListener(this);
 
+        addAndMakeVisible(addFolderButton);
+        addFolderButton.setButtonText("Add Folder");
+        addFolderButton.setTooltip("Import a folder and keep the library in step with it");
+        addFolderButton.addListener(this);
+
+        addChildComponent(importProgressBar); // Shown while dropped files are being imported
+        importer.onFiles = [this](const std::vector<juce::File>& files) { addImportedFiles(files); };
+        importer.onFinished = [this] { updateImportProgress(); };
+
         // Add columns to the table
         tableListBox.getHeader().addColumn("Title", 1, 200);
         tableListBox.getHeader().addColumn("Artist", 2, 150);
         tableListBox.getHeader().addColumn("Album", 3, 150);
         tableListBox.getHeader().addColumn("Duration", 4, 100);
         tableListBox.getHeader().addColumn("File Path", 5, 250);
+        tableListBox.getHeader().addColumn("BPM", 6, 60);
+        tableListBox.getHeader().addColumn("Key", 7, 50);
+        tableListBox.getHeader().addColumn("Genre", 8, 100);
 
         // Set up FlexBox properties
         flexBox.flexDirection = juce::FlexBox::Direction::column; // Stack vertically
-        loadFileListFromFile();
+        loadLibrary();
+
+        searchWorker.onResults = [this](const LibrarySearchWorker::Results& results) { showSearchResults(results); };
+        folderWatcher.onChanges = [this](const std::vector<FolderWatcher::Change>& changes) { applyFolderChanges(changes); };
+        watchedFolders.addLines(GlobalStateManager::getInstance().getStringSetting("libraryFolders"));
+        watchedFolders.removeEmptyStrings();
+        restartFolderWatcher();
     }
 
     ~MusicLibrary() override
     {
-        saveFileListToFile();
+        autoMix.onDisabled = nullptr;
+        folderWatcher.stop();
+        scanner.cancelAll();
+        database.flush();
+    }
+
+    /** For headless use with no message loop running: wait until the current search has been shown in full */
+    bool waitForSearchResults(int timeoutMs)
+    {
+        const double endMs = juce::Time::getMillisecondCounterHiRes() + timeoutMs;
+
+        while (!searchComplete && juce::Time::getMillisecondCounterHiRes() < endMs)
+        {
+            searchWorker.deliverPendingResults();
+
+            if (!searchComplete)
+                juce::Thread::sleep(1);
+        }
+
+        return searchComplete;
     }
 
     // Override methods from TableListBoxModel
     int getNumRows() override
     {
-        return filteredData.size(); // Return the number of filtered entries
+        return (int) filteredRows.size(); // Return the number of filtered entries
     }
 
     void paintRowBackground(Graphics& g, int rowNumber, int width, int height, bool rowIsSelected) override
     {
+        OTODECKS_PROFILE_PAINT("MusicLibrary::paintRowBackground");
         if (rowIsSelected)
             g.fillAll(juce::Colours::darkgrey);
         else
@@ -81,16 +154,23 @@ public:
 
     void paintCell(Graphics& g, int rowNumber, int columnId, int width, int height, bool rowIsSelected) override
     {
+        OTODECKS_PROFILE_PAINT("MusicLibrary::paintCell");
         g.setColour(juce::Colours::white); // Set text color to white
 
-        const MusicEntry& entry = filteredData[rowNumber];
+        if (!juce::isPositiveAndBelow(rowNumber, (int) filteredRows.size()))
+            return;
+
+        const int row = filteredRows[(size_t) rowNumber];
         switch (columnId)
         {
-        case 1: g.drawText(entry.title, 2, 0, width - 4, height, juce::Justification::left); break;
-        case 2: g.drawText(entry.artist, 2, 0, width - 4, height, juce::Justification::left); break;
-        case 3: g.drawText(entry.album, 2, 0, width - 4, height, juce::Justification::left); break;
-        case 4: g.drawText(entry.duration, 2, 0, width - 4, height, juce::Justification::left); break;
-        case 5: g.drawText(entry.filePath, 2, 0, width - 4, height, juce::Justification::left); break;
+        case 1: g.drawText(model.getTitle(row), 2, 0, width - 4, height, juce::Justification::left); break;
+        case 2: g.drawText(model.getArtist(row).isNotEmpty() ? model.getArtist(row) : "Unknown Artist", 2, 0, width - 4, height, juce::Justification::left); break;
+        case 3: g.drawText(model.getAlbum(row).isNotEmpty() ? model.getAlbum(row) : "Unknown Album", 2, 0, width - 4, height, juce::Justification::left); break;
+        case 4: g.drawText(model.getDurationText(row), 2, 0, width - 4, height, juce::Justification::left); break;
+        case 5: g.drawText(model.getFilePath(row), 2, 0, width - 4, height, juce::Justification::left); break;
+        case 6: if (model.getBpm(row) > 0.0f) g.drawText(juce::String(model.getBpm(row), 1), 2, 0, width - 4, height, juce::Justification::left); break;
+        case 7: g.drawText(model.getKey(row), 2, 0, width - 4, height, juce::Justification::left); break;
+        case 8: g.drawText(model.getGenre(row), 2, 0, width - 4, height, juce::Justification::left); break;
         }
     }
 
@@ -102,11 +182,18 @@ public:
         flexBox.items.add(juce::FlexItem(searchBox).withFlex(0).withHeight(30)); // Search box
         flexBox.items.add(juce::FlexItem(tableListBox).withFlex(1)); // Table list box
 
+        if (importProgressBar.isVisible())
+            flexBox.items.add(juce::FlexItem(importProgressBar).withFlex(0).withHeight(20).withMargin(juce::FlexItem::Margin(4, 5, 0, 5)));
+
         // Create a container for buttons and add them to the FlexBox
         juce::FlexBox buttonBox;
         buttonBox.flexDirection = juce::FlexBox::Direction::row; // Stack buttons horizontally
         buttonBox.items.add(juce::FlexItem(addToDeck1Button).withFlex(4).withMargin(5)); // Button 1
         buttonBox.items.add(juce::FlexItem(addToDeck2Button).withFlex(4).withMargin(5)); // Button 2
+        buttonBox.items.add(juce::FlexItem(previewButton).withFlex(2).withMargin(5)); // Headphone audition
+        buttonBox.items.add(juce::FlexItem(queueButton).withFlex(2).withMargin(5)); // Automix queue
+        buttonBox.items.add(juce::FlexItem(autoMixButton).withFlex(1.5).withMargin(5));
+        buttonBox.items.add(juce::FlexItem(addFolderButton).withFlex(1.5).withMargin(5)); // Watched folders
         buttonBox.items.add(juce::FlexItem(clearButton).withFlex(1).withMargin(5)); // Button 3
 
         // Add the buttonBox to the main FlexBox
@@ -116,38 +203,25 @@ public:
         flexBox.performLayout(getLocalBounds());
     }
 
+    /** Add a file to the library. The row appears straight away and is filled in when the scanner has read it. */
     void loadMusicFile(const juce::File& musicFile)
     {
-        juce::String title = musicFile.getFileNameWithoutExtension();
-        juce::String artist = "Unknown Artist";
-        juce::String album = "Unknown Album";
-        juce::String duration = "Unknown Duration";
-        juce::String filePath = musicFile.getFullPathName(); // Get the full file path
-
-        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(musicFile));
-        if (reader != nullptr)
-        {
-            int seconds = static_cast<int>(reader->lengthInSamples / reader->sampleRate) % 60;
-            int minutes = static_cast<int>((reader->lengthInSamples / reader->sampleRate) / 60) % 60;
-            duration = juce::String::formatted("%02d:%02d", minutes, seconds);
-        }
-
-        data.add({ title, artist, album, duration, filePath });
-        filteredData = data; // Update filtered data
+        addPlaceholder(musicFile);
+        filterData();
         tableListBox.updateContent();
     }
 
-    void addToDeck(int deckNumber, const MusicEntry& entry)
+    void addToDeck(int deckNumber, int row)
     {
         // Implement your logic to add the selected entry to the specified deck
         if (deckNumber == 1)
         {
-            DBG("Added to Deck 1: " << entry.title);
+            DBG("Added to Deck 1: " << model.getTitle(row));
             // Add logic to handle Deck 1
         }
         else if (deckNumber == 2)
         {
-            DBG("Added to Deck 2: " << entry.title);
+            DBG("Added to Deck 2: " << model.getTitle(row));
             // Add logic to handle Deck 2
         }
     }
@@ -155,154 +229,609 @@ public:
     juce::String getFileListAsString() const
     {
         juce::StringArray fileList;
-        for (const auto& entry : data)
+        for (int row = 0; row < model.size(); ++row)
         {
-            fileList.add(entry.filePath);
+            fileList.add(model.getFilePath(row));
         }
         return fileList.joinIntoString("\n");
     }
 
 private:
-    void saveFileListToFile() const
+    /** Add a row for a file and queue it for scanning. Returns false if the file is in the library already. */
+    bool addPlaceholder(const juce::File& musicFile)
+    {
+        if (rowByPath.contains(musicFile.getFullPathName()))
+            return false;
+
+        LibraryModel::Track track;
+        track.title = musicFile.getFileNameWithoutExtension();
+        track.filePath = musicFile.getFullPathName(); // Get the full file path
+
+        // Recorded straight away, so a file dropped just before quitting is scanned on the next launch
+        const int row = model.add(track);
+        rowByPath.set(track.filePath, row);
+        indexRow(row);
+        database.store(track);
+        queueScan(row);
+        return true;
+    }
+
+    void indexRow(int row)
+    {
+        LibrarySearchIndex::Row indexed;
+        indexed.fields[LibrarySearchIndex::title] = model.getTitle(row);
+        indexed.fields[LibrarySearchIndex::artist] = model.getArtist(row);
+        indexed.fields[LibrarySearchIndex::album] = model.getAlbum(row);
+        indexed.fields[LibrarySearchIndex::genre] = model.getGenre(row);
+        indexed.fields[LibrarySearchIndex::key] = model.getKey(row);
+        indexed.bpm = model.getBpm(row);
+
+        if (model.isScanned(row))
+            indexed.lengthSeconds = model.getLengthSeconds(row);
+
+        if (model.hasLoudness(row))
+            indexed.loudness = model.getLoudness(row);
+
+        {
+            const juce::ScopedWriteLock sl(searchIndexLock);
+            searchIndex.setRow(row, indexed);
+        }
+
+        const double noValue = std::numeric_limits<double>::quiet_NaN();
+        const double lengthSeconds = model.getLengthSeconds(row);
+        sortOrder.setText(1, row, model.getTitle(row));
+        sortOrder.setPooledText(2, row, model.getArtistId(row), model.getArtist(row));
+        sortOrder.setPooledText(3, row, model.getAlbumId(row), model.getAlbum(row));
+        sortOrder.setNumber(4, row, model.isScanned(row) && lengthSeconds >= 0.0 ? lengthSeconds : noValue);
+        sortOrder.setText(5, row, model.getFilePath(row));
+        sortOrder.setNumber(6, row, model.getBpm(row) > 0.0f ? model.getBpm(row) : noValue);
+        sortOrder.setPooledText(7, row, model.getKeyId(row), model.getKey(row));
+        sortOrder.setPooledText(8, row, model.getGenreId(row), model.getGenre(row));
+    }
+
+    /** Renumber the path lookup and the search index after rows have been removed */
+    void rebuildRowLookups()
+    {
+        const juce::ScopedWriteLock sl(searchIndexLock);
+        rowByPath.clear();
+        searchIndex.clear();
+        sortOrder.clear();
+
+        for (int row = 0; row < model.size(); ++row)
+        {
+            rowByPath.set(model.getFilePath(row), row);
+            indexRow(row);
+        }
+    }
+
+    void queueScan(int row)
+    {
+        if (!options.scanFiles)
+            return;
+
+        scanner.scan(juce::File(model.getFilePath(row)));
+
+        if (!isTimerRunning())
+            startTimer(scanBatchIntervalMs);
+    }
+
+    void queueLoudness(int row)
     {
-        juce::String fileListString = getFileListAsString();
-        juce::File userDocumentsFolder = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory);
-        juce::File file = userDocumentsFolder.getChildFile("MusicLibraryFileList.txt");
-        file.replaceWithText(fileListString);
+        if (!options.scanFiles)
+            return;
+
+        scanner.analyseLoudness(juce::File(model.getFilePath(row)));
+
+        if (!isTimerRunning())
+            startTimer(scanBatchIntervalMs);
     }
 
+    /** Add a batch of files found by the importer, skipping any already in the library */
+    void addImportedFiles(const std::vector<juce::File>& files)
+    {
+        for (const auto& file : files)
+            if (addPlaceholder(file))
+                ++importQueued;
+
+        database.flush();
+        refreshSearch();
+        tableListBox.updateContent();
+        updateImportProgress();
+    }
 
-    void loadFileListFromFile()
+    /** Show how far the import has got, and hide the bar once every imported file has been probed */
+    void updateImportProgress()
     {
-        juce::File userDocumentsFolder = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory);
-        juce::File file = userDocumentsFolder.getChildFile("MusicLibraryFileList.txt");
+        if (!importProgressBar.isVisible())
+            return;
+
+        if (!importer.isImporting() && scanner.getNumProbesOutstanding() == 0)
+        {
+            importProgressBar.setVisible(false);
+            importQueued = importProbed = 0;
+            resized();
+            return;
+        }
+
+        // Probes for files the watcher added at the same time count too, so keep it in range
+        importProbed = juce::jmin(importProbed, importQueued);
+        importProgress = importQueued > 0 ? (double) importProbed / importQueued : -1.0; // Spins until files turn up
+        importProgressBar.setTextToDisplay("Importing " + juce::String(importProbed) + " of " + juce::String(importQueued)
+                                           + (importer.isImporting() ? "+" : ""));
+    }
+
+    void timerCallback() override
+    {
+        // Apply everything the workers have finished since the last tick as one batch
+        const auto results = scanner.takeResults();
+
+        for (const auto& result : results)
+        {
+            // The file may have been removed from the library while it was being read
+            if (!rowByPath.contains(result.filePath))
+                continue;
+
+            const int row = rowByPath[result.filePath];
+            LibraryModel::Track track = model.get(row);
+
+            if (result.loudnessOnly)
+            {
+                track.loudness = result.loudness;
+                track.truePeak = result.truePeak;
+                track.hasLoudness = result.hasLoudness;
+
+                model.set(row, track);
+                indexRow(row);
+                database.store(track);
+                continue;
+            }
+
+            if (importProgressBar.isVisible())
+                ++importProbed;
+
+            track.scanned = true;
+            track.lengthSeconds = result.lengthSeconds;
+            track.fileSize = result.fileSize;
+            track.modificationTime = result.modificationTime;
+
+            // Keep the file-name title for files without one in their tags
+            const auto& tags = result.tags;
+            if (tags.title.isNotEmpty())  track.title = tags.title;
+            if (tags.artist.isNotEmpty()) track.artist = tags.artist;
+            if (tags.album.isNotEmpty())  track.album = tags.album;
+            track.genre = tags.genre;
+            track.key = tags.key;
+            track.bpm = tags.bpm;
+
+            // A changed file's old measurement no longer applies; the loudness pass brings a new one
+            track.hasLoudness = false;
+
+            model.set(row, track);
+            indexRow(row);
+            database.store(track);
+        }
+
+        updateImportProgress();
+
+        if (!results.empty())
+        {
+            database.flush();
+            refreshSearch();
+            tableListBox.updateContent();
+            tableListBox.repaint();
+        }
+
+        if (!scanner.isBusy())
+            stopTimer();
+    }
 
-        if (file.existsAsFile())
+    void loadLibrary()
+    {
+        // Known tracks come straight from the database; only files that were never scanned are opened
+        for (const auto& track : database.open())
         {
-            juce::String fileListString = file.loadFileAsString();
-            juce::StringArray fileList;
-            fileList.addLines(fileListString);
+            const int row = model.add(track);
+            rowByPath.set(track.filePath, row);
+            indexRow(row);
+
+            if (!track.scanned)
+                queueScan(row);
+            else if (!track.hasLoudness && track.lengthSeconds >= 0.0)
+                queueLoudness(row); // Probed, but the app closed before it was measured
+        }
 
-            for (const auto& filePath : fileList)
+        if (model.size() > 0)
+        {
+            size_t indexBytes;
             {
-                juce::File musicFile(filePath);
-                if (musicFile.existsAsFile())
+                const juce::ScopedReadLock sl(searchIndexLock);
+                indexBytes = searchIndex.getMemoryUsage();
+            }
+
+            const size_t modelBytes = model.getMemoryUsage();
+            const size_t sortBytes = sortOrder.getMemoryUsage();
+            const size_t bytes = modelBytes + indexBytes + sortBytes;
+            const auto perTrack = [this](size_t b) { return juce::String((juce::int64) (b / (size_t) model.size())); };
+
+            juce::Logger::writeToLog("Library: " + juce::String(model.size()) + " tracks in " + juce::File::descriptionOfSizeInBytes((juce::int64) bytes)
+                                     + ", " + perTrack(bytes) + " bytes per track (tracks " + perTrack(modelBytes)
+                                     + ", search index " + perTrack(indexBytes) + ", sort keys " + perTrack(sortBytes) + ")");
+        }
+
+        // Filter once for the whole library rather than once per file
+        filterData();
+        tableListBox.updateContent();
+    }
+
+    void restartFolderWatcher()
+    {
+        if (!options.watchFolders)
+            return;
+
+        // Seed the watcher with what the library already knows, so only differences get rescanned
+        std::map<juce::String, FolderWatcher::Fingerprint> known;
+        for (int row = 0; row < model.size(); ++row)
+            if (model.isScanned(row))
+                known[model.getFilePath(row)] = { model.getFileSize(row), model.getModificationTime(row) };
+
+        juce::Array<juce::File> folders;
+        for (const auto& path : watchedFolders)
+            folders.add(juce::File(path));
+
+        folderWatcher.watch(folders, formatManager.getWildcardForAllFormats(), std::move(known));
+    }
+
+    void addWatchedFolder()
+    {
+        folderChooser = std::make_unique<juce::FileChooser>("Add a folder to the library",
+            juce::File::getSpecialLocation(juce::File::userMusicDirectory));
+
+        folderChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectDirectories,
+            [this](const juce::FileChooser& chooser)
+            {
+                const juce::File folder = chooser.getResult();
+                if (!folder.isDirectory() || watchedFolders.contains(folder.getFullPathName()))
+                    return;
+
+                watchedFolders.add(folder.getFullPathName());
+                GlobalStateManager::getInstance().setStringSetting("libraryFolders", watchedFolders.joinIntoString("\n"));
+
+                // The watcher's first pass imports everything in the new folder
+                restartFolderWatcher();
+            });
+    }
+
+    /** New and modified files are (re)scanned; deleted ones leave the library */
+    void applyFolderChanges(const std::vector<FolderWatcher::Change>& changes)
+    {
+        std::vector<int> rowsToRemove;
+
+        for (const auto& change : changes)
+        {
+            const bool known = rowByPath.contains(change.filePath);
+
+            if (change.removed)
+            {
+                if (known)
                 {
-                    loadMusicFile(musicFile);
+                    rowsToRemove.push_back(rowByPath[change.filePath]);
+                    database.remove(change.filePath);
                 }
             }
+            else if (known)
+            {
+                const int row = rowByPath[change.filePath];
+                if (!model.isScanned(row))
+                    continue; // Already queued
+
+                model.setUnscanned(row);
+                indexRow(row);
+                queueScan(row);
+            }
+            else
+            {
+                addPlaceholder(juce::File(change.filePath));
+            }
+        }
+
+        const bool removedAny = !rowsToRemove.empty();
+
+        if (removedAny)
+        {
+            // Keep showing the rows that survive, renumbered, until the search catches up
+            std::vector<int> renumbered((size_t) model.size(), 0);
+            for (const int row : rowsToRemove)
+                renumbered[(size_t) row] = -1;
+
+            for (int row = 0, next = 0; row < model.size(); ++row)
+                if (renumbered[(size_t) row] == 0)
+                    renumbered[(size_t) row] = next++;
+
+            std::vector<int> shown;
+            for (const int row : filteredRows)
+                if (renumbered[(size_t) row] >= 0)
+                    shown.push_back(renumbered[(size_t) row]);
+
+            filteredRows = std::move(shown);
+
+            // Remove them all in one pass, then renumber once
+            model.remove(std::move(rowsToRemove));
+            rebuildRowLookups();
+            trackToReselect = -1; // Renumbered
         }
+
+        database.flush();
+
+        // Results of the running search use the old row numbers, so they mustn't be let in
+        if (removedAny)
+            filterData();
+        else
+            refreshSearch();
+        tableListBox.updateContent();
+        tableListBox.repaint();
     }
 
     void textEditorTextChanged(TextEditor& editor) override
     {
         if (&editor == &searchBox)
+            filterData(true); // Typing: wait for a pause before searching
+    }
+
+    /** Search the library again in the background; the table updates when the results arrive */
+    void filterData(bool debounce = false)
+    {
+        searchGeneration = searchWorker.search(searchBox.getText(), debounce);
+        searchComplete = false;
+        refreshPending = false; // The new search reads the index as it is now
+    }
+
+    /**
+     * Search again after tracks were added or rescanned in the background. Waits for a pause like typing
+     * does, and lets a search already on its way finish first, so a busy scan doesn't keep restarting it.
+     */
+    void refreshSearch()
+    {
+        if (searchComplete)
+            filterData(true);
+        else
+            refreshPending = true;
+    }
+
+    void showSearchResults(const LibrarySearchWorker::Results& results)
+    {
+        if (results.generation != searchGeneration)
+            return; // Superseded by a newer search, or by a change to the library
+
+        searchComplete = results.complete;
+
+        // The rows are about to shift under the selection; follow the track instead
+        const int selectedRow = getSelectedTrack() >= 0 ? getSelectedTrack() : trackToReselect;
+
+        // A sorted table is built up from each batch's rows rather than taken in ranked order
+        if (!sortOrder.isSorted())
         {
-            filterData();
-            tableListBox.updateContent(); // Update the table to show filtered results
+            filteredRows = results.ranked;
         }
+        else
+        {
+            if (results.replace)
+                filteredRows.clear();
+
+            sortOrder.merge(filteredRows, results.added);
+        }
+
+        tableListBox.updateContent();
+        tableListBox.repaint();
+        reselectTrack(selectedRow);
+
+        // A search still running may yet find it
+        trackToReselect = getSelectedTrack() < 0 && !results.complete ? selectedRow : -1;
+
+        if (results.complete && refreshPending)
+            filterData(true);
     }
 
-    void filterData()
+    void sortOrderChanged(int newSortColumnId, bool isForwards) override
     {
-        juce::String searchText = searchBox.getText().toLowerCase();
-        filteredData.clear();
+        sortOrder.setSortColumn(newSortColumnId, isForwards);
 
-        for (const auto& entry : data)
+        // Unsorted means ranked by the search again. Results still to come merge into the new order
+        if (newSortColumnId == 0)
         {
-            if (entry.title.toLowerCase().contains(searchText) ||
-                entry.artist.toLowerCase().contains(searchText) ||
-                entry.album.toLowerCase().contains(searchText))
-            {
-                filteredData.add(entry);
-            }
+            filterData();
+            return;
         }
+
+        const int selectedRow = getSelectedTrack();
+
+        sortOrder.sort(filteredRows);
+        tableListBox.updateContent();
+        tableListBox.repaint();
+        reselectTrack(selectedRow);
+    }
+
+    /** Keep a track selected wherever it has moved to in the table, or select nothing if it isn't shown */
+    void reselectTrack(int row)
+    {
+        if (row < 0)
+            return;
+
+        const juce::ScopedValueSetter<bool> restoring(restoringSelection, true);
+        const auto it = std::find(filteredRows.begin(), filteredRows.end(), row);
+
+        if (it != filteredRows.end())
+            tableListBox.selectRow((int) (it - filteredRows.begin()));
+        else
+            tableListBox.deselectAllRows();
+    }
+
+    /** The model row of the selected table row, or -1 if nothing is selected */
+    int getSelectedTrack() const
+    {
+        if (!juce::isPositiveAndBelow(currentlySelectedRow, (int) filteredRows.size()))
+            return -1;
+
+        return filteredRows[(size_t) currentlySelectedRow];
     }
 
     void selectedRowsChanged(int /*lastRowSelected*/) override
     {
         // Update the currently selected row whenever the selection changes
         currentlySelectedRow = tableListBox.getSelectedRow();
+
+        if (restoringSelection)
+            return; // Same track as before, just moved by a sort or a search
+
+        trackToReselect = -1; // The user has chosen for themselves
+
+        // Start decoding the preview excerpt now so pressing Preview plays instantly,
+        // and follow the selection if an audition is already running
+        if (const int row = getSelectedTrack(); row >= 0)
+        {
+            juce::File file(model.getFilePath(row));
+            if (previewButton.getToggleState())
+                preview.play(file);
+            else
+                preview.prefetch(file);
+        }
     }
 
     void buttonClicked(juce::Button* button) override
     {
         if (button == &addToDeck1Button)
         {
-            if (currentlySelectedRow >= 0 && currentlySelectedRow < filteredData.size())
-            {
-                const MusicEntry& entry = filteredData[currentlySelectedRow];
-                deckGUI1.loadFile(entry.filePath);
-            }
+            if (const int row = getSelectedTrack(); row >= 0)
+                deckGUI1.loadFile(model.getFilePath(row), model.getNormalisationGainDb(row));
         }
         else if (button == &addToDeck2Button)
         {
-            if (currentlySelectedRow >= 0 && currentlySelectedRow < filteredData.size())
+            if (const int row = getSelectedTrack(); row >= 0)
+                deckGUI2.loadFile(model.getFilePath(row), model.getNormalisationGainDb(row));
+        }
+        else if (button == &queueButton)
+        {
+            if (const int row = getSelectedTrack(); row >= 0)
             {
-                const MusicEntry& entry = filteredData[currentlySelectedRow];
-                deckGUI2.loadFile(entry.filePath);
+                autoMix.enqueue({ model.getFilePath(row), model.getNormalisationGainDb(row), model.getBpm(row) });
+                queueButton.setButtonText("Queue (" + juce::String(autoMix.getQueueLength()) + ")");
             }
         }
+        else if (button == &previewButton)
+        {
+            const int row = getSelectedTrack();
+            if (previewButton.getToggleState() && row >= 0)
+                preview.play(juce::File(model.getFilePath(row)));
+            else
+                preview.stop();
+        }
+        else if (button == &autoMixButton)
+        {
+            autoMix.setEnabled(autoMixButton.getToggleState());
+        }
         else if (button == &clearButton)
         {
             clearButtonClicked();
         }
+        else if (button == &addFolderButton)
+        {
+            addWatchedFolder();
+        }
     }
 
     // Implement drag-and-drop methods
     bool isInterestedInFileDrag(const juce::StringArray& files) override
     {
-        // Check if any of the files are valid music files
+        // Folders, or files of any format we can read
         for (const auto& file : files)
         {
-            if (file.endsWithIgnoreCase(".mp3") || file.endsWithIgnoreCase(".wav") || file.endsWithIgnoreCase(".flac"))
+            if (importer.canImport(juce::File(file)))
                 return true;
         }
         return false;
     }
 
-
-
     void filesDropped(const juce::StringArray& files, int x, int y) override
     {
-        for (const auto& filePath : files)
+        // Folders are walked and files probed in the background; rows appear as they're found
+        importer.import(files);
+
+        if (!importProgressBar.isVisible())
         {
-            juce::File file(filePath);
-            if (file.existsAsFile())
-            {
-                loadMusicFile(file); // Load the music file
-            }
+            importProgress = -1.0;
+            importProgressBar.setTextToDisplay("Importing...");
+            importProgressBar.setVisible(true);
+            resized();
         }
-
-        saveFileListToFile();
     }
 
-
     void MusicLibrary::clearButtonClicked()
     {
-        data.clear();
-        filteredData.clear();
-        saveFileListToFile();
-        loadFileListFromFile();
+        // Stop watching too, or the folders would be imported straight back
+        folderWatcher.stop();
+        watchedFolders.clear();
+        GlobalStateManager::getInstance().setStringSetting("libraryFolders", {});
+
+        importer.cancel();
+        scanner.cancelAll();
+        updateImportProgress();
+        model.clear();
+        rowByPath.clear();
+        {
+            const juce::ScopedWriteLock sl(searchIndexLock);
+            searchIndex.clear();
+        }
+        sortOrder.clear();
+        filteredRows.clear();
+        trackToReselect = -1;
+        database.clear();
+        filterData(); // Drops any results still on their way for the old library
         tableListBox.updateContent();
     }
 
+    const Options options;
     juce::AudioFormatManager formatManager; // Declare the formatManager
+    LibraryImporter importer{ formatManager }; // Expands dropped folders into the files to add
+    LibraryScanner scanner{ formatManager }; // Reads durations and loudness on worker threads
+    LibraryDatabase database;                // Every track's metadata, kept between sessions
+    FolderWatcher folderWatcher;             // Reports files added, changed or deleted in the watched folders
+    juce::StringArray watchedFolders;        // Folder paths, saved as the "libraryFolders" setting
+    std::unique_ptr<juce::FileChooser> folderChooser; // Kept alive while the async chooser is open
+    static constexpr int scanBatchIntervalMs = 100; // How often finished scans are applied to the table
 
 
     juce::TableListBox tableListBox;
-    juce::Array<MusicEntry> data;         // Store original data
-    juce::Array<MusicEntry> filteredData; // Store filtered data
+    LibraryModel model;                   // Every track in the library, column by column
+    juce::HashMap<juce::String, int> rowByPath; // Row in model of each file
+    LibrarySearchIndex searchIndex;       // Trigram index over the searchable fields of model
+    juce::ReadWriteLock searchIndexLock;  // Written here, read by searchWorker
+    LibrarySearchWorker searchWorker{ searchIndex, searchIndexLock }; // Runs the searches off the message thread
+    int searchGeneration = 0;             // The search whose results the table should show
+    bool searchComplete = false;          // The table holds every result of searchGeneration
+    bool refreshPending = false;          // The library changed while searchGeneration was running
+    std::vector<int> filteredRows;        // Rows of model matching the search, in table order
+    LibrarySortOrder sortOrder;           // Collation keys for every column, and the column the table is sorted by
     juce::TextEditor searchBox;           // Search box
     juce::TextButton addToDeck1Button;    // Button to add to Deck 1
     juce::TextButton addToDeck2Button;
     juce::TextButton clearButton;    // Button to add to Deck 2
+    juce::TextButton addFolderButton;     // Add a watched folder to the library
+    juce::TextButton queueButton;         // Append the selected row to the automix queue
+    juce::ToggleButton autoMixButton;     // Turn automix on and off
+    juce::TextButton previewButton;       // Audition the selected row on the headphone outputs
+    double importProgress = -1.0;         // Read by importProgressBar; negative spins
+    juce::ProgressBar importProgressBar{ importProgress };
+    int importQueued = 0;                 // Files the current import has added to the library
+    int importProbed = 0;                 // Of those, the ones the scanner has probed
     int currentlySelectedRow = -1;         // Store the currently selected row
+    bool restoringSelection = false;       // Reselecting the same track after a sort or search moved it
+    int trackToReselect = -1;              // Selected track the running search hasn't found again yet
 
     juce::FlexBox flexBox; // FlexBox for layout
 
     DeckGUI& deckGUI1;
     DeckGUI& deckGUI2;
+    AutoMixEngine& autoMix;
+    PreviewPlayer& preview;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MusicLibrary)
 };
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <map>
+#include <string>
+
+//==============================================================================
+/**
+ * Counts and times the custom paint routines. Paint calls only happen on the
+ * message thread, so the counters need no locking.
+ *
+ * Each instrumented site registers its counter once, through a function-local
+ * static, so an enabled measurement costs two clock reads and a disabled one a
+ * single flag check.
+ */
+class PaintProfiler
+{
+public:
+    struct Counter
+    {
+        int64 paints = 0;
+        double totalMs = 0.0;
+        double maxMs = 0.0;
+        double lastMs = 0.0;
+    };
+
+    // Singleton pattern, as for GlobalStateManager
+    static PaintProfiler& getInstance()
+    {
+        static PaintProfiler instance;
+        return instance;
+    }
+
+    Counter& getCounter(const char* name) { return counters[name]; }
+    const std::map<std::string, Counter>& getCounters() const { return counters; }
+
+    void reset()
+    {
+        for (auto& entry : counters)
+            entry.second = {};
+    }
+
+    void setEnabled(bool shouldBeEnabled) { enabled = shouldBeEnabled; }
+    bool isEnabled() const { return enabled; }
+
+    /** Times its own lifetime into a counter */
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(Counter& c)
+            : counter(c), startTicks(getInstance().isEnabled() ? Time::getHighResolutionTicks() : 0)
+        {
+        }
+
+        ~ScopedTimer()
+        {
+            if (startTicks == 0)
+                return;
+
+            const double ms = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) * 1000.0;
+            ++counter.paints;
+            counter.totalMs += ms;
+            counter.lastMs = ms;
+            counter.maxMs = jmax(counter.maxMs, ms);
+        }
+
+    private:
+        Counter& counter;
+        const int64 startTicks;
+    };
+
+private:
+    PaintProfiler() = default;
+
+    std::map<std::string, Counter> counters; // Nodes never move, so sites can keep references
+    bool enabled = false;
+};
+
+/** Put at the top of a paint routine to have it show up in the profiler */
+#define OTODECKS_PROFILE_PAINT(name) \
+    static PaintProfiler::Counter& paintProfilerCounter = PaintProfiler::getInstance().getCounter(name); \
+    const PaintProfiler::ScopedTimer paintProfilerTimer(paintProfilerCounter)
+
+//==============================================================================
+/** Translucent table of paint counts and times, laid over a corner of the window. */
+class PaintProfilerOverlay : public Component, private Timer
+{
+public:
+    PaintProfilerOverlay()
+    {
+        setInterceptsMouseClicks(false, false);
+    }
+
+    static constexpr int preferredWidth = 430;
+    static constexpr int preferredHeight = 240;
+
+    /** Show or hide the overlay; profiling only runs while it is visible */
+    void setActive(bool shouldBeActive)
+    {
+        PaintProfiler::getInstance().reset();
+        PaintProfiler::getInstance().setEnabled(shouldBeActive);
+        setVisible(shouldBeActive);
+
+        if (shouldBeActive)
+            startTimer(refreshIntervalMs);
+        else
+            stopTimer();
+    }
+
+    void paint(Graphics& g) override
+    {
+        auto area = getLocalBounds().removeFromTop(rowHeight * (rows.size() + 1)).reduced(4);
+
+        g.setColour(Colours::black.withAlpha(0.75f));
+        g.fillRect(area);
+        g.setColour(Colours::white);
+        g.setFont(Font(Font::getDefaultMonospacedFontName(), 12.0f, Font::plain));
+
+        area.reduce(4, 0);
+        for (const auto& row : rows)
+            g.drawText(row, area.removeFromTop(rowHeight), Justification::centredLeft, false);
+    }
+
+private:
+    void timerCallback() override
+    {
+        // Report the interval just finished, then start a fresh one
+        rows.clearQuick();
+        rows.add(String("component").paddedRight(' ', 34) + "  /s   avg ms  max ms");
+
+        const double seconds = refreshIntervalMs / 1000.0;
+        for (const auto& entry : PaintProfiler::getInstance().getCounters())
+        {
+            const auto& c = entry.second;
+            rows.add(String(entry.first).paddedRight(' ', 34)
+                + String(c.paints / seconds, 0).paddedLeft(' ', 5)
+                + String(c.paints > 0 ? c.totalMs / c.paints : 0.0, 3).paddedLeft(' ', 9)
+                + String(c.maxMs, 3).paddedLeft(' ', 8));
+        }
+
+        PaintProfiler::getInstance().reset();
+        repaint();
+    }
+
+    static constexpr int refreshIntervalMs = 1000;
+    static constexpr int rowHeight = 14;
+    StringArray rows;
+};
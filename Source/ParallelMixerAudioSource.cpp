@@ -0,0 +1,307 @@
+#include "ParallelMixerAudioSource.h"
+
+//==============================================================================
+ParallelMixerAudioSource::Worker::Worker(ParallelMixerAudioSource& o, int index)
+    : Thread("Deck render " + String(index)), owner(o)
+{
+    // Pin each worker to its own core, skipping core 0 which usually hosts the device thread
+    const int numCpus = SystemStats::getNumCpus();
+    if (numCpus > 1)
+        setAffinityMask((uint32) 1 << (uint32) ((index + 1) % jmin(numCpus, 32)));
+}
+
+void ParallelMixerAudioSource::Worker::run()
+{
+    while (!threadShouldExit())
+    {
+        // Sleep until the device thread hands out a block. Waking late is harmless:
+        // the device thread renders whatever is left unclaimed.
+        wait(-1);
+
+        const uint32 current = owner.generation.load(std::memory_order_acquire);
+
+        if (current != lastGeneration)
+        {
+            lastGeneration = current;
+            owner.renderPendingInputs();
+        }
+    }
+}
+
+//==============================================================================
+ParallelMixerAudioSource::ParallelMixerAudioSource(int numWorkers)
+    : numWorkerThreads(jmax(0, numWorkers))
+{
+}
+
+ParallelMixerAudioSource::~ParallelMixerAudioSource()
+{
+    stopWorkers();
+}
+
+void ParallelMixerAudioSource::addInputSource(AudioSource* input)
+{
+    if (input == nullptr)
+        return;
+
+    const ScopedLock sl(lock);
+
+    if (inputs.contains(input))
+        return;
+
+    if (currentSampleRate > 0.0)
+        input->prepareToPlay(bufferSizeExpected, currentSampleRate);
+
+    inputBuffers.add(new AudioBuffer<float>(2, jmax(1, bufferSizeExpected)));
+    preFaderBuffers.add(new AudioBuffer<float>(2, jmax(1, bufferSizeExpected)));
+    preFaderInputs.add(dynamic_cast<PreFaderSource*>(input));
+    inputs.add(input);
+}
+
+void ParallelMixerAudioSource::removeAllInputs()
+{
+    const ScopedLock sl(lock);
+    inputs.clear();
+    preFaderInputs.clear();
+    inputBuffers.clear();
+    preFaderBuffers.clear();
+}
+
+void ParallelMixerAudioSource::setParallelProcessingEnabled(bool shouldBeEnabled)
+{
+    if (shouldBeEnabled == parallelEnabled.load())
+        return;
+
+    parallelEnabled = shouldBeEnabled;
+
+    if (shouldBeEnabled)
+        startWorkers();
+    else
+        stopWorkers();
+}
+
+void ParallelMixerAudioSource::setInputCueEnabled(int inputIndex, bool shouldBeEnabled)
+{
+    jassert(inputIndex >= 0 && inputIndex < 32);
+    const uint32 bit = 1u << (uint32) inputIndex;
+
+    if (shouldBeEnabled)
+        cueMask.fetch_or(bit);
+    else
+        cueMask.fetch_and(~bit);
+}
+
+void ParallelMixerAudioSource::startWorkers()
+{
+    // Real-time scheduling with the block period as a hint, rather than just a high priority
+    const auto options = Thread::RealtimeOptions{}.withPeriodMs(blockPeriodMs.load());
+
+    OwnedArray<Worker> started;
+
+    for (int i = 0; i < numWorkerThreads; ++i)
+    {
+        auto* worker = started.add(new Worker(*this, i));
+        worker->startRealtimeThread(options);
+    }
+
+    const ScopedLock sl(lock);
+    workers.swapWith(started);
+}
+
+void ParallelMixerAudioSource::stopWorkers()
+{
+    // Take the workers away from the device thread first, so it never wakes one that is stopping
+    OwnedArray<Worker> stopping;
+    {
+        const ScopedLock sl(lock);
+        stopping.swapWith(workers);
+    }
+
+    for (auto* worker : stopping)
+    {
+        worker->signalThreadShouldExit();
+        worker->notify();
+    }
+
+    for (auto* worker : stopping)
+        worker->stopThread(1000);
+}
+
+//==============================================================================
+void ParallelMixerAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    const ScopedLock sl(lock);
+
+    bufferSizeExpected = samplesPerBlockExpected;
+    currentSampleRate = sampleRate;
+    blockPeriodMs = sampleRate > 0.0 ? 1000.0 * samplesPerBlockExpected / sampleRate : 10.0;
+
+    for (int i = 0; i < inputs.size(); ++i)
+    {
+        inputs.getUnchecked(i)->prepareToPlay(samplesPerBlockExpected, sampleRate);
+        inputBuffers.getUnchecked(i)->setSize(2, samplesPerBlockExpected);
+        preFaderBuffers.getUnchecked(i)->setSize(2, samplesPerBlockExpected);
+    }
+}
+
+void ParallelMixerAudioSource::releaseResources()
+{
+    const ScopedLock sl(lock);
+
+    for (auto* input : inputs)
+        input->releaseResources();
+
+    for (auto* buffer : inputBuffers)
+        buffer->setSize(2, 0);
+
+    for (auto* buffer : preFaderBuffers)
+        buffer->setSize(2, 0);
+
+    currentSampleRate = 0.0;
+    bufferSizeExpected = 0;
+}
+
+void ParallelMixerAudioSource::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    getNextAudioBlock(bufferToFill, nullptr);
+}
+
+void ParallelMixerAudioSource::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill, const AudioSourceChannelInfo* cue)
+{
+    const ScopedLock sl(lock);
+
+    const int numInputs = inputs.size();
+    const int numSamples = bufferToFill.numSamples;
+    auto& output = *bufferToFill.buffer;
+
+    if (numInputs == 0)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        if (cue != nullptr)
+            cue->clearActiveBufferRegion();
+        return;
+    }
+
+    const uint32 cuedInputs = cue != nullptr ? cueMask.load(std::memory_order_relaxed) : 0;
+    const bool useWorkers = parallelEnabled.load(std::memory_order_relaxed)
+        && !workers.isEmpty()
+        && numInputs >= minInputsForParallel;
+
+    if (!useWorkers && cuedInputs == 0)
+    {
+        // Serial path: same as MixerAudioSource, first input renders straight into the output
+        inputs.getUnchecked(0)->getNextAudioBlock(bufferToFill);
+
+        for (int i = 1; i < numInputs; ++i)
+        {
+            auto& scratch = *inputBuffers.getUnchecked(i);
+            scratch.setSize(jmax(1, output.getNumChannels()), numSamples, false, false, true);
+            AudioSourceChannelInfo info(&scratch, 0, numSamples);
+            inputs.getUnchecked(i)->getNextAudioBlock(info);
+
+            for (int chan = 0; chan < output.getNumChannels(); ++chan)
+                output.addFrom(chan, bufferToFill.startSample, scratch, chan, 0, numSamples);
+        }
+    }
+    else
+    {
+        for (auto* scratch : inputBuffers)
+            scratch->setSize(jmax(1, output.getNumChannels()), numSamples, false, false, true);
+
+        for (auto* scratch : preFaderBuffers)
+            scratch->setSize(2, numSamples, false, false, true);
+
+        blockCueMask.store(cuedInputs, std::memory_order_relaxed);
+        renderAllInputs(numSamples, useWorkers);
+
+        for (int chan = 0; chan < output.getNumChannels(); ++chan)
+        {
+            output.copyFrom(chan, bufferToFill.startSample, *inputBuffers.getUnchecked(0), chan, 0, numSamples);
+
+            for (int i = 1; i < numInputs; ++i)
+                output.addFrom(chan, bufferToFill.startSample, *inputBuffers.getUnchecked(i), chan, 0, numSamples);
+        }
+    }
+
+    if (cue == nullptr)
+        return;
+
+    // Cue bus: the PFL inputs' own blocks, from before their faders where they have one,
+    // blended with the finished master
+    const float blend = cueMasterMix.load(std::memory_order_relaxed);
+    auto& cueBuffer = *cue->buffer;
+    const int cueChannels = jmin(2, cueBuffer.getNumChannels());
+
+    for (int chan = 0; chan < cueChannels; ++chan)
+    {
+        cueBuffer.clear(chan, cue->startSample, numSamples);
+
+        for (int i = 0; i < numInputs; ++i)
+        {
+            auto& scratch = preFaderInputs.getUnchecked(i) != nullptr ? *preFaderBuffers.getUnchecked(i) : *inputBuffers.getUnchecked(i);
+            if ((cuedInputs & (1u << (uint32) i)) != 0 && chan < scratch.getNumChannels())
+                cueBuffer.addFromWithRamp(chan, cue->startSample, scratch.getReadPointer(chan), numSamples,
+                    1.0f - lastCueMasterMix, 1.0f - blend);
+        }
+
+        const int masterChan = jmin(chan, output.getNumChannels() - 1);
+        if (masterChan >= 0)
+            cueBuffer.addFromWithRamp(chan, cue->startSample, output.getReadPointer(masterChan, bufferToFill.startSample),
+                numSamples, lastCueMasterMix, blend);
+    }
+
+    lastCueMasterMix = blend;
+}
+
+void ParallelMixerAudioSource::renderAllInputs(int numSamples, bool useWorkers)
+{
+    // Publish the block. nextJob is stored last with release so a worker that claims a job
+    // from this block also sees the block size and job count written above it.
+    blockNumSamples.store(numSamples, std::memory_order_relaxed);
+    blockNumJobs.store(inputs.size(), std::memory_order_relaxed);
+    jobsRemaining.store(inputs.size(), std::memory_order_relaxed);
+    nextJob.store(0, std::memory_order_release);
+
+    if (useWorkers)
+    {
+        generation.fetch_add(1, std::memory_order_release);
+
+        for (auto* worker : workers)
+            worker->notify();
+    }
+
+    renderPendingInputs();
+
+    // Sleep until the worker that finishes the last claimed input wakes us. The event may
+    // still be set from a block we finished ourselves, hence the loop.
+    while (jobsRemaining.load(std::memory_order_acquire) > 0)
+        blockFinished.wait(-1);
+}
+
+void ParallelMixerAudioSource::renderPendingInputs()
+{
+    for (;;)
+    {
+        const int job = nextJob.fetch_add(1, std::memory_order_acq_rel);
+
+        if (job >= blockNumJobs.load(std::memory_order_relaxed))
+            return;
+
+        renderInput(job);
+
+        if (jobsRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            blockFinished.signal();
+    }
+}
+
+void ParallelMixerAudioSource::renderInput(int index)
+{
+    const int numSamples = blockNumSamples.load(std::memory_order_relaxed);
+    AudioSourceChannelInfo info(inputBuffers.getUnchecked(index), 0, numSamples);
+    auto* preFaderInput = preFaderInputs.getUnchecked(index);
+
+    if (preFaderInput != nullptr && (blockCueMask.load(std::memory_order_relaxed) & (1u << (uint32) index)) != 0)
+        preFaderInput->getNextAudioBlock(info, AudioSourceChannelInfo(preFaderBuffers.getUnchecked(index), 0, numSamples));
+    else
+        inputs.getUnchecked(index)->getNextAudioBlock(info);
+}
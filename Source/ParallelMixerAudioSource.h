@@ -0,0 +1,117 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+//==============================================================================
+/**
+ * Drop-in replacement for MixerAudioSource that can render each input on its
+ * own real-time worker thread and then sum the results on the device thread.
+ *
+ * Work is handed out through atomic counters: the device thread bumps a block
+ * generation and wakes the workers, every thread (including the device thread
+ * itself) claims inputs with fetch_add until none are left, and whichever
+ * thread finishes the last input wakes the device thread to mix. Idle workers
+ * sleep on their events rather than polling. If a worker is slow to wake, the
+ * device thread simply renders the remaining inputs itself, so the serial path
+ * is always the worst case rather than a deadline miss.
+ */
+class ParallelMixerAudioSource : public AudioSource
+{
+public:
+    /**
+     * Implemented by inputs with a fader of their own, so the cue bus can hear
+     * them from before it: a deck pulled down on the master can still be
+     * pre-listened.
+     */
+    class PreFaderSource
+    {
+    public:
+        virtual ~PreFaderSource() = default;
+
+        /** Audio thread: render the next block into postFader as usual, and the same audio before the fader into preFader. */
+        virtual void getNextAudioBlock(const AudioSourceChannelInfo& postFader, const AudioSourceChannelInfo& preFader) = 0;
+    };
+
+    explicit ParallelMixerAudioSource(int numWorkerThreads = getDefaultNumWorkers());
+    ~ParallelMixerAudioSource() override;
+
+    /** Add an input to be mixed. The mixer does not take ownership. */
+    void addInputSource(AudioSource* input);
+    void removeAllInputs();
+
+    /** Turn the worker pool on or off. Call from the message thread. */
+    void setParallelProcessingEnabled(bool shouldBeEnabled);
+    bool isParallelProcessingEnabled() const { return parallelEnabled.load(); }
+
+    /** Below this many inputs the mixer renders serially on the device thread. */
+    void setMinInputsForParallel(int numInputs) { minInputsForParallel = jmax(1, numInputs); }
+
+    /** Send an input to the cue (headphone) bus as well as the master; pre-fader if it is a PreFaderSource. */
+    void setInputCueEnabled(int inputIndex, bool shouldBeEnabled);
+    bool isInputCueEnabled(int inputIndex) const { return (cueMask.load() & (1u << (uint32) inputIndex)) != 0; }
+
+    /** Headphone blend: 0 hears only the cued inputs, 1 hears only the master. */
+    void setCueMasterMix(float mix) { cueMasterMix = jlimit(0.0f, 1.0f, mix); }
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+    void releaseResources() override;
+
+    /**
+     * Render the master bus and, if cue is not null, the cue bus. Both are summed
+     * straight from each input's own blocks, so neither bus is copied from the other.
+     * Works on any pair of buffers, whether or not they belong to a real device.
+     */
+    void getNextAudioBlock(const AudioSourceChannelInfo& master, const AudioSourceChannelInfo* cue);
+
+    /** One worker per spare core, leaving one for the device thread and one for the UI. */
+    static int getDefaultNumWorkers() { return jlimit(0, 3, SystemStats::getNumCpus() - 2); }
+
+private:
+    class Worker : public Thread
+    {
+    public:
+        Worker(ParallelMixerAudioSource& owner, int index);
+        void run() override;
+
+    private:
+        ParallelMixerAudioSource& owner;
+        uint32 lastGeneration = 0;
+    };
+
+    void renderAllInputs(int numSamples, bool useWorkers); // Every input into its scratch buffer
+    void renderPendingInputs(); // Claim and render inputs until none are left
+    void renderInput(int index);
+    void startWorkers();
+    void stopWorkers();
+
+    Array<AudioSource*> inputs;
+    Array<PreFaderSource*> preFaderInputs;          // Per input, null when it has no fader of its own
+    OwnedArray<AudioBuffer<float>> inputBuffers;    // One scratch buffer per input
+    OwnedArray<AudioBuffer<float>> preFaderBuffers; // Each input's pre-fader block, while it is cued
+    OwnedArray<Worker> workers; // Swapped in and out under lock, started and stopped outside it
+    CriticalSection lock; // Guards the input and worker lists, as in MixerAudioSource
+    WaitableEvent blockFinished; // Signalled by whichever thread renders the last input of a block
+
+    int numWorkerThreads;
+    int minInputsForParallel = 2;
+    int bufferSizeExpected = 0;
+    double currentSampleRate = 0.0;
+
+    // Per-block job state, written by the device thread before the generation is bumped
+    std::atomic<int> blockNumSamples{ 0 };
+    std::atomic<int> blockNumJobs{ 0 };
+    std::atomic<uint32> blockCueMask{ 0 }; // Inputs to render pre-fader as well this block
+    std::atomic<double> blockPeriodMs{ 10.0 }; // Given to the OS as the workers' real-time period
+    std::atomic<uint32> generation{ 0 };
+    std::atomic<int> nextJob{ 0 };
+    std::atomic<int> jobsRemaining{ 0 };
+    std::atomic<bool> parallelEnabled{ false };
+
+    std::atomic<uint32> cueMask{ 0 };         // Bit per input with PFL on
+    std::atomic<float> cueMasterMix{ 0.0f };
+    float lastCueMasterMix = 0.0f;            // Audio thread, for ramping the blend
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParallelMixerAudioSource)
+};
@@ -0,0 +1,68 @@
+#include "PreloadedAudioSource.h"
+
+//==============================================================================
+PreloadedAudioSource::PreloadedAudioSource(std::unique_ptr<AudioFormatReader> reader, std::unique_ptr<AudioBuffer<float>> h,
+                                           TimeSliceThread& readAheadThread)
+    : head(std::move(h)), totalLength(reader->lengthInSamples)
+{
+    const int samplesToBuffer = roundToInt(reader->sampleRate * readAheadSeconds);
+
+    // Don't prefill on prepare: that would block whoever prepares us, usually the message thread
+    tail = std::make_unique<BufferingAudioSource>(new AudioFormatReaderSource(reader.release(), true),
+        readAheadThread, true, samplesToBuffer, 2, false);
+
+    seekTail();
+}
+
+void PreloadedAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    tail->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void PreloadedAudioSource::releaseResources()
+{
+    tail->releaseResources();
+}
+
+void PreloadedAudioSource::setNextReadPosition(int64 newPosition)
+{
+    position = newPosition;
+    seekTail();
+}
+
+void PreloadedAudioSource::seekTail()
+{
+    const int64 tailStart = jmax(position, (int64) head->getNumSamples());
+
+    // Only on seeks: moving the read-ahead takes its lock
+    if (tail->getNextReadPosition() != tailStart)
+        tail->setNextReadPosition(tailStart);
+}
+
+void PreloadedAudioSource::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    auto& output = *bufferToFill.buffer;
+    const int headLength = head->getNumSamples();
+    int done = 0;
+
+    // The decoded opening first...
+    if (position < headLength)
+    {
+        done = (int) jmin((int64) bufferToFill.numSamples, headLength - position);
+
+        for (int chan = 0; chan < output.getNumChannels(); ++chan)
+            output.copyFrom(chan, bufferToFill.startSample, *head, jmin(chan, head->getNumChannels() - 1), (int) position, done);
+    }
+
+    position += done;
+
+    // ...then whatever the read-ahead thread has buffered beyond it
+    if (done < bufferToFill.numSamples)
+    {
+        const int remaining = bufferToFill.numSamples - done;
+
+        seekTail();
+        tail->getNextAudioBlock(AudioSourceChannelInfo(&output, bufferToFill.startSample + done, remaining));
+        position += remaining;
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <memory>
+
+//==============================================================================
+/**
+ * Plays a track whose opening has already been decoded into memory, and
+ * streams the rest from its reader through a BufferingAudioSource.
+ *
+ * The read-ahead thread starts filling from the end of the decoded opening as
+ * soon as the source is prepared, so by the time playback gets there the
+ * samples are already waiting. Starting the track therefore costs no disk or
+ * codec time, however long it is, and only a few seconds of it are ever held
+ * in memory.
+ */
+class PreloadedAudioSource : public PositionableAudioSource
+{
+public:
+    /** head holds the first samples of reader's output; the source owns both. */
+    PreloadedAudioSource(std::unique_ptr<AudioFormatReader> reader, std::unique_ptr<AudioBuffer<float>> head,
+                         TimeSliceThread& readAheadThread);
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(int64 newPosition) override;
+    int64 getNextReadPosition() const override { return position; }
+    int64 getTotalLength() const override { return totalLength; }
+    bool isLooping() const override { return false; }
+
+    static constexpr double readAheadSeconds = 4.0; // Streamed audio buffered ahead of the playhead
+
+private:
+    /** Point the read-ahead at the first sample the head can't supply from here on */
+    void seekTail();
+
+    std::unique_ptr<AudioBuffer<float>> head;
+    const int64 totalLength;
+    std::unique_ptr<BufferingAudioSource> tail; // Everything after the head
+    int64 position = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PreloadedAudioSource)
+};
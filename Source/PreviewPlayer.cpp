@@ -0,0 +1,198 @@
+#include "PreviewPlayer.h"
+
+PreviewPlayer::PreviewPlayer(AudioFormatManager& fm)
+    : Thread("Preview decoder"), formatManager(fm)
+{
+    startThread(Thread::Priority::low);
+}
+
+PreviewPlayer::~PreviewPlayer()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread(4000);
+}
+
+//==============================================================================
+void PreviewPlayer::prefetch(const File& file)
+{
+    const String path = file.getFullPathName();
+    {
+        const ScopedLock sl(cacheLock);
+
+        if (findCached(path) != nullptr || requests.contains(path))
+            return;
+
+        requests.add(path);
+    }
+    notify();
+}
+
+void PreviewPlayer::play(const File& file)
+{
+    const String path = file.getFullPathName();
+    Excerpt::Ptr excerpt;
+    {
+        const ScopedLock sl(cacheLock);
+        excerpt = findCached(path);
+
+        if (excerpt == nullptr)
+            pendingPlayPath = path;
+    }
+
+    if (excerpt != nullptr)
+        startPlaying(excerpt);
+    else
+        prefetch(file);
+}
+
+void PreviewPlayer::stop()
+{
+    {
+        const ScopedLock sl(cacheLock);
+        pendingPlayPath.clear();
+    }
+    startPlaying(nullptr);
+}
+
+bool PreviewPlayer::isPlaying() const
+{
+    const SpinLock::ScopedLockType sl(playLock);
+    return playing != nullptr && playPosition < playing->buffer.getNumSamples();
+}
+
+void PreviewPlayer::startPlaying(Excerpt::Ptr excerpt)
+{
+    {
+        const SpinLock::ScopedLockType sl(playLock);
+        std::swap(playing, excerpt);
+        playPosition = 0;
+    }
+    // The previous excerpt (now in 'excerpt') is released here, off the audio thread
+}
+
+//==============================================================================
+void PreviewPlayer::prepareToPlay(double sampleRate)
+{
+    deviceSampleRate = sampleRate;
+}
+
+void PreviewPlayer::addNextBlock(AudioBuffer<float>& buffer, int firstChannel, int startSample, int numSamples)
+{
+    const SpinLock::ScopedTryLockType sl(playLock);
+
+    if (!sl.isLocked() || playing == nullptr)
+        return;
+
+    const auto& source = playing->buffer;
+    const int num = jmin(numSamples, source.getNumSamples() - playPosition);
+
+    if (num <= 0)
+        return;
+
+    for (int ch = 0; ch < 2 && firstChannel + ch < buffer.getNumChannels(); ++ch)
+        buffer.addFrom(firstChannel + ch, startSample, source, ch, playPosition, num);
+
+    playPosition += num;
+}
+
+//==============================================================================
+PreviewPlayer::Excerpt::Ptr PreviewPlayer::findCached(const String& path)
+{
+    const double rate = deviceSampleRate.load();
+
+    for (int i = 0; i < cache.size(); ++i)
+    {
+        auto* excerpt = cache.getUnchecked(i);
+        if (excerpt->path == path && excerpt->sampleRate == rate)
+        {
+            cache.move(i, -1); // Mark as most recently used
+            return Excerpt::Ptr(excerpt);
+        }
+    }
+    return nullptr;
+}
+
+void PreviewPlayer::run()
+{
+    while (!threadShouldExit())
+    {
+        String path;
+        {
+            const ScopedLock sl(cacheLock);
+            if (!requests.isEmpty())
+            {
+                // Newest request first: the user has probably moved on from older selections
+                path = requests[requests.size() - 1];
+                requests.remove(requests.size() - 1);
+            }
+        }
+
+        const double rate = deviceSampleRate.load();
+
+        if (path.isEmpty() || rate <= 0.0)
+        {
+            wait(path.isEmpty() ? -1 : 100);
+            continue;
+        }
+
+        auto excerpt = decode(path, rate);
+        bool shouldPlay = false;
+        {
+            const ScopedLock sl(cacheLock);
+
+            if (excerpt != nullptr)
+            {
+                cache.add(excerpt);
+                while (cache.size() > maxCachedExcerpts)
+                    cache.remove(0);
+            }
+
+            shouldPlay = pendingPlayPath == path;
+            if (shouldPlay)
+                pendingPlayPath.clear();
+        }
+
+        if (shouldPlay && excerpt != nullptr)
+            startPlaying(excerpt);
+    }
+}
+
+PreviewPlayer::Excerpt::Ptr PreviewPlayer::decode(const String& path, double targetSampleRate)
+{
+    std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(File(path)));
+
+    if (reader == nullptr || reader->sampleRate <= 0.0 || reader->lengthInSamples <= 0)
+        return nullptr;
+
+    // Audition from a third of the way in, where most tracks have got going
+    const int64 excerptLength = (int64) (excerptSeconds * reader->sampleRate);
+    const int64 start = jmax((int64) 0, jmin(reader->lengthInSamples / 3, reader->lengthInSamples - excerptLength));
+    const int sourceLength = (int) jmin(excerptLength, reader->lengthInSamples - start);
+
+    AudioBuffer<float> source(2, sourceLength + 4);
+    source.clear();
+    reader->read(&source, 0, sourceLength, start, true, true);
+
+    Excerpt::Ptr excerpt(new Excerpt());
+    excerpt->path = path;
+    excerpt->sampleRate = targetSampleRate;
+
+    // Resample once here so playback is a straight copy
+    const double ratio = reader->sampleRate / targetSampleRate;
+    const int outputLength = (int) (sourceLength / ratio);
+    excerpt->buffer.setSize(2, outputLength);
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        LagrangeInterpolator interpolator;
+        interpolator.process(ratio, source.getReadPointer(ch), excerpt->buffer.getWritePointer(ch), outputLength);
+    }
+
+    // Short fades so the excerpt doesn't click in or out
+    const int fadeLength = jmin(outputLength / 2, roundToInt(targetSampleRate * 0.01));
+    excerpt->buffer.applyGainRamp(0, fadeLength, 0.0f, 1.0f);
+    excerpt->buffer.applyGainRamp(outputLength - fadeLength, fadeLength, 1.0f, 0.0f);
+
+    return excerpt;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+//==============================================================================
+/**
+ * Lightweight audition player for library rows.
+ *
+ * Each previewed file is decoded once, on the player's own thread, into a short
+ * excerpt already resampled to the device rate, and kept in a small LRU cache.
+ * Playback is then a plain copy from memory into whichever output channels the
+ * caller hands to addNextBlock(), so it never touches the deck players or their
+ * readers.
+ */
+class PreviewPlayer : private Thread
+{
+public:
+    explicit PreviewPlayer(AudioFormatManager& formatManager);
+    ~PreviewPlayer() override;
+
+    /** Decode the excerpt in the background so a later play() starts instantly. */
+    void prefetch(const File& file);
+
+    /** Start auditioning the file; plays as soon as its excerpt is ready. */
+    void play(const File& file);
+    void stop();
+    bool isPlaying() const;
+
+    //==============================================================================
+    /** Audio thread */
+    void prepareToPlay(double sampleRate);
+
+    /** Audio thread: add the next block to the two channels starting at firstChannel. */
+    void addNextBlock(AudioBuffer<float>& buffer, int firstChannel, int startSample, int numSamples);
+
+    static constexpr double excerptSeconds = 30.0;
+    static constexpr int maxCachedExcerpts = 4;
+
+private:
+    struct Excerpt : public ReferenceCountedObject
+    {
+        using Ptr = ReferenceCountedObjectPtr<Excerpt>;
+
+        String path;
+        double sampleRate = 0.0;
+        AudioBuffer<float> buffer;
+    };
+
+    void run() override;
+    Excerpt::Ptr findCached(const String& path);
+    Excerpt::Ptr decode(const String& path, double targetSampleRate);
+    void startPlaying(Excerpt::Ptr excerpt);
+
+    AudioFormatManager& formatManager;
+
+    CriticalSection cacheLock; // Guards the cache, requests and pendingPlayPath
+    ReferenceCountedArray<Excerpt> cache; // Most recently used last
+    StringArray requests;                 // Paths waiting to be decoded
+    String pendingPlayPath;               // Play this as soon as it has been decoded
+
+    SpinLock playLock; // Guards the two fields below; the audio thread only ever try-locks it
+    Excerpt::Ptr playing;
+    int playPosition = 0;
+
+    std::atomic<double> deviceSampleRate{ 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PreviewPlayer)
+};
@@ -0,0 +1,188 @@
+#include "RenderBenchmark.h"
+#include "DeckGUI.h"
+#include "MusicLibrary.h"
+#include "PaintProfiler.h"
+#include <numeric>
+
+namespace
+{
+    constexpr int warmUpFrames = 5;
+    constexpr int timedFrames = 60;
+    constexpr int syntheticTracks = 5000;
+
+    struct FrameStats
+    {
+        double firstMs = 0.0; // Cold frame, including any cache building
+        double meanMs = 0.0;
+        double medianMs = 0.0;
+        double p95Ms = 0.0;
+        double maxMs = 0.0;
+    };
+
+    FrameStats renderFrames(Component& component, int width, int height)
+    {
+        component.setSize(width, height);
+        Image image(Image::ARGB, width, height, true);
+
+        auto renderOnce = [&]()
+        {
+            image.clear(image.getBounds());
+            Graphics g(image);
+            const int64 start = Time::getHighResolutionTicks();
+            component.paintEntireComponent(g, false);
+            return Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1000.0;
+        };
+
+        FrameStats stats;
+        stats.firstMs = renderOnce();
+
+        for (int i = 1; i < warmUpFrames; ++i)
+            renderOnce();
+
+        std::vector<double> times;
+        for (int i = 0; i < timedFrames; ++i)
+            times.push_back(renderOnce());
+
+        std::sort(times.begin(), times.end());
+        stats.meanMs = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+        stats.medianMs = times[times.size() / 2];
+        stats.p95Ms = times[(times.size() * 95) / 100];
+        stats.maxMs = times.back();
+        return stats;
+    }
+
+    /** A fixed, already scanned library, the same on every machine */
+    void writeSyntheticLibrary(const File& databaseFile)
+    {
+        static const char* const genres[] = { "House", "Techno", "Drum & Bass", "Disco", "Ambient", "Hip Hop" };
+        static const char* const keys[] = { "1A", "2A", "3A", "4A", "5A", "6A", "7A", "8A", "9A", "10A", "11A", "12A",
+                                            "1B", "2B", "3B", "4B", "5B", "6B", "7B", "8B", "9B", "10B", "11B", "12B" };
+
+        LibraryDatabase database(databaseFile, false);
+        database.open();
+
+        Random random(0x07d3c5); // Fixed seed, so every run draws the same rows
+
+        for (int i = 0; i < syntheticTracks; ++i)
+        {
+            const int artist = random.nextInt(400);
+            const int album = random.nextInt(6);
+
+            LibraryDatabase::Track track;
+            track.artist = "Artist " + String(artist);
+            track.album = "Album " + String(artist) + "-" + String(album);
+            track.title = "Track " + String(i).paddedLeft('0', 5);
+            track.genre = genres[random.nextInt(numElementsInArray(genres))];
+            track.key = keys[random.nextInt(numElementsInArray(keys))];
+            track.filePath = "/benchmark/" + track.artist + "/" + track.album + "/" + track.title + ".mp3";
+            track.bpm = 80.0 + random.nextInt(900) / 10.0;
+            track.lengthSeconds = 120.0 + random.nextInt(360);
+            track.loudness = -14.0f + 8.0f * random.nextFloat();
+            track.truePeak = -1.0f;
+            track.hasLoudness = true;
+            track.scanned = true;
+            database.store(track);
+        }
+
+        database.flush();
+    }
+
+    void report(const String& name, int width, int height, const FrameStats& stats)
+    {
+        std::cout << name.paddedRight(' ', 14) << String(width).paddedLeft(' ', 5) << "x" << String(height).paddedRight(' ', 5)
+                  << String(stats.firstMs, 3).paddedLeft(' ', 10)
+                  << String(stats.meanMs, 3).paddedLeft(' ', 10)
+                  << String(stats.medianMs, 3).paddedLeft(' ', 10)
+                  << String(stats.p95Ms, 3).paddedLeft(' ', 10)
+                  << String(stats.maxMs, 3).paddedLeft(' ', 10) << std::endl;
+    }
+}
+
+int RenderBenchmark::run(const String& audioFilePath)
+{
+    AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    // A private cache directory, so the benchmark neither reads nor pollutes the user's
+    const File cacheDirectory = File::getSpecialLocation(File::tempDirectory).getChildFile("OtoDecksRenderBenchmark");
+    WaveformCache waveformCache(cacheDirectory);
+
+    int playerIndex1 = 1, playerIndex2 = 2;
+    DJAudioPlayer player1(formatManager), player2(formatManager);
+    DeckGUI deck1(&player1, formatManager, waveformCache, playerIndex1,
+        Colours::black, Colours::springgreen, Colours::springgreen, Colours::black,
+        Colours::springgreen, Colours::springgreen, Colours::springgreen);
+    DeckGUI deck2(&player2, formatManager, waveformCache, playerIndex2,
+        Colours::black, Colours::dodgerblue, Colours::dodgerblue, Colours::black,
+        Colours::dodgerblue, Colours::dodgerblue, Colours::dodgerblue);
+    AutoMixEngine autoMix(formatManager, player1, player2);
+    PreviewPlayer previewPlayer(formatManager);
+
+    // A temporary database of synthetic tracks, with no folder watching, scanning or legacy
+    // import, so the library draws the same rows everywhere and the user's own is left alone
+    TemporaryFile databaseFile(".db");
+    writeSyntheticLibrary(databaseFile.getFile());
+
+    MusicLibrary::Options libraryOptions;
+    libraryOptions.databaseFile = databaseFile.getFile();
+    libraryOptions.watchFolders = false;
+    libraryOptions.scanFiles = false;
+    libraryOptions.importLegacyFileList = false;
+    MusicLibrary library(deck1, deck2, autoMix, previewPlayer, libraryOptions);
+
+    // Search results arrive through the message loop, which isn't running here
+    if (!library.waitForSearchResults(10000))
+    {
+        std::cout << "render benchmark: the library search did not finish" << std::endl;
+        return 1;
+    }
+
+    if (audioFilePath.isNotEmpty())
+    {
+        if (!deck1.loadFile(audioFilePath))
+        {
+            std::cout << "render benchmark: could not load " << audioFilePath << std::endl;
+            return 1;
+        }
+
+        // Let the background analysis finish so every frame draws the full waveform
+        for (int waited = 0; waited < 30000; waited += 10)
+        {
+            auto waveform = deck1.getWaveform();
+            if (waveform == nullptr || waveform->isComplete())
+                break;
+            Thread::sleep(10);
+        }
+    }
+
+    PaintProfiler::getInstance().setEnabled(true);
+
+    std::cout << "component      size            first ms   mean ms median ms    p95 ms    max ms" << std::endl;
+
+    const Rectangle<int> windowSizes[] = { { 800, 600 }, { 1280, 720 }, { 1920, 1080 } };
+
+    for (const auto& window : windowSizes)
+    {
+        // Same proportions as MainComponent: two decks side by side above the library
+        const int deckWidth = window.getWidth() / 2;
+        const int deckHeight = window.getHeight() * 5 / 9;
+        const int libraryHeight = window.getHeight() * 5 / 18;
+
+        report("DeckGUI", deckWidth, deckHeight, renderFrames(deck1, deckWidth, deckHeight));
+        report("MusicLibrary", window.getWidth(), libraryHeight, renderFrames(library, window.getWidth(), libraryHeight));
+    }
+
+    std::cout << std::endl << "routine                              paints   avg ms   max ms" << std::endl;
+
+    for (const auto& entry : PaintProfiler::getInstance().getCounters())
+    {
+        const auto& c = entry.second;
+        std::cout << String(entry.first).paddedRight(' ', 36)
+                  << String(c.paints).paddedLeft(' ', 7)
+                  << String(c.paints > 0 ? c.totalMs / c.paints : 0.0, 3).paddedLeft(' ', 9)
+                  << String(c.maxMs, 3).paddedLeft(' ', 9) << std::endl;
+    }
+
+    PaintProfiler::getInstance().setEnabled(false);
+    return 0;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/**
+ * Headless UI rendering benchmark, run with `OtoDecks --render-benchmark [audio file]`.
+ *
+ * Builds a deck and a music library of synthetic tracks, kept in a temporary
+ * database, without opening a window or an audio device. Paints them into
+ * offscreen Images at several window sizes and prints per-frame times
+ * followed by the per-routine breakdown from PaintProfiler.
+ * If an audio file is given it is loaded onto the deck first, so the waveform
+ * views have something to draw.
+ */
+namespace RenderBenchmark
+{
+    /** Run the benchmark and return the process exit code */
+    int run(const String& audioFilePath);
+}
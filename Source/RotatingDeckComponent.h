@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "PaintProfiler.h"
 
 class RotatingDeckComponent : public Component
 {
@@ -12,9 +13,50 @@ public:
 
     void paint(Graphics& g) override
     {
-        // Clear the background with transparency
-        g.fillAll(Colours::transparentBlack);
+        OTODECKS_PROFILE_PAINT("RotatingDeckComponent::paint");
+        const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
 
+        // The rings don't change as the deck turns, so they are rasterised once per size and just blitted
+        if (!platter.isValid() || platterScale != scale
+            || platter.getWidth() != roundToInt(getWidth() * scale) || platter.getHeight() != roundToInt(getHeight() * scale))
+            renderPlatter(scale);
+
+        g.drawImageTransformed(platter, AffineTransform::scale(1.0f / scale));
+
+        // Draw the rotation marker line with the specified color
+        const auto geometry = getGeometry();
+        Graphics::ScopedSaveState state(g);
+        g.addTransform(AffineTransform::rotation(currentAngle, geometry.centre.x, geometry.centre.y));
+        g.setColour(lineColour);
+        g.fillRect(getMarkerRect(geometry));
+    }
+
+    void resized() override
+    {
+        platter = Image(); // Re-rendered at the new size on the next paint
+    }
+
+    void setAngle(float angle) {
+        jassert(angle >= 0.0f && angle <= MathConstants<float>::twoPi);
+
+        if (angle == currentAngle)
+            return;
+
+        // Only the marker moves, so only the areas it is leaving and entering need repainting
+        repaint(getMarkerBounds(currentAngle));
+        currentAngle = angle;
+        repaint(getMarkerBounds(currentAngle));
+    }
+
+private:
+    struct Geometry
+    {
+        Point<float> centre;
+        float deckSize; // Diameter of the black platter
+    };
+
+    Geometry getGeometry() const
+    {
         // Get the bounds of the component
         auto bounds = getLocalBounds().toFloat();
         float width = bounds.getWidth();
@@ -35,41 +77,52 @@ public:
             centerY = bounds.getY() + sliderSize * 0.5f;
         }
 
+        // Make the deck smaller than the component by applying a scale factor
+        float deckScaleFactor = 0.8f; // Adjust this factor to make the deck smaller or larger (0.8 means 80% of original size)
+        return { { centerX, centerY }, sliderSize * deckScaleFactor };
+    }
 
-        // Apply rotation
-        g.addTransform(AffineTransform::rotation(currentAngle, centerX, centerY));
+    /** The marker before rotation: a bar from the centre out to the platter's edge */
+    static Rectangle<float> getMarkerRect(const Geometry& geometry)
+    {
+        return { geometry.centre.x, geometry.centre.y, geometry.deckSize * 0.5f, geometry.deckSize * 0.01f };
+    }
 
-        // Draw the rotating deck (make it smaller by applying a scale factor)
-        float deckScaleFactor = 0.8f; // Adjust this factor to make the deck smaller or larger (0.8 means 80% of original size)
-        float smallerSliderSize = sliderSize * deckScaleFactor;
+    Rectangle<int> getMarkerBounds(float angle) const
+    {
+        const auto geometry = getGeometry();
+        return getMarkerRect(geometry)
+            .transformedBy(AffineTransform::rotation(angle, geometry.centre.x, geometry.centre.y))
+            .getSmallestIntegerContainer()
+            .expanded(2);
+    }
+
+    void renderPlatter(float scale)
+    {
+        platterScale = scale;
+        platter = Image(Image::ARGB, jmax(1, roundToInt(getWidth() * scale)), jmax(1, roundToInt(getHeight() * scale)), true);
+
+        Graphics g(platter);
+        g.addTransform(AffineTransform::scale(scale));
+
+        const auto geometry = getGeometry();
+        const float centerX = geometry.centre.x, centerY = geometry.centre.y;
+        float smallerSliderSize = geometry.deckSize;
 
         g.setColour(Colours::black);
         g.fillEllipse(centerX - smallerSliderSize * 0.5f, centerY - smallerSliderSize * 0.5f, smallerSliderSize, smallerSliderSize);
-        
 
-        // Draw the rotation marker line with the specified color
         g.setColour(lineColour);
-        g.fillRect(centerX, centerY, smallerSliderSize * 0.5f, smallerSliderSize*0.01f);
         smallerSliderSize = smallerSliderSize * 1.10f;
-        g.drawEllipse(centerX - smallerSliderSize * 0.5f, centerY - smallerSliderSize * 0.5f, smallerSliderSize, smallerSliderSize, smallerSliderSize * 0.01f); // Ring thickness is set to 2.0f
+        g.drawEllipse(centerX - smallerSliderSize * 0.5f, centerY - smallerSliderSize * 0.5f, smallerSliderSize, smallerSliderSize, smallerSliderSize * 0.01f); // Ring thickness scales with the deck
         g.setColour(lineColour.withAlpha(0.2f));
         g.drawEllipse(centerX - smallerSliderSize * 0.5f, centerY - smallerSliderSize * 0.5f, smallerSliderSize, smallerSliderSize, smallerSliderSize * 0.05f);
     }
 
-    void resized() override
-    {
-        // This is where you can set the bounds for child components
-    }
-
-    void setAngle(float angle) {
-        jassert(angle >= 0.0f && angle <= MathConstants<float>::twoPi);
-        currentAngle = angle;
-        repaint();
-    }
-
-private:
     float currentAngle;
     Colour lineColour;
+    Image platter; // Cached rings, at physical pixel resolution
+    float platterScale = 1.0f;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RotatingDeckComponent)
 };
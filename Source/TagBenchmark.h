@@ -0,0 +1,18 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/**
+ * Library scanning benchmark, run with `OtoDecks --tag-benchmark <folder>`.
+ *
+ * Finds every audio file under the folder and reports files per second for
+ * TagReader, and for opening a decoder on each file as the scanner used to.
+ * On Linux each file is evicted from the page cache before every pass, so the
+ * numbers are for a cold cache; elsewhere the second and later passes are warm.
+ */
+namespace TagBenchmark
+{
+    /** Run the benchmark and return the process exit code */
+    int run(const String& folderPath);
+}
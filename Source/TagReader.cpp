@@ -0,0 +1,606 @@
+#include "TagReader.h"
+
+namespace
+{
+    constexpr int maxTextFrameBytes = 1 << 16;              // Longer text frames are skipped rather than read
+    constexpr int maxCommentBlockBytes = 1 << 20;           // Vorbis comments beyond this (embedded art) are ignored
+    constexpr int maxUnsynchronisedTagBytes = 16 << 20;     // Whole-tag unsynchronisation needs the tag in memory
+    constexpr int maxOggPages = 64;                         // Give up if the comment packet hasn't appeared by then
+
+    enum class Field { none, title, artist, album, genre, bpm, key };
+
+    void assign(TrackTags& tags, Field field, const String& value)
+    {
+        // The first tag to provide a field wins, so an ID3v1 fallback never overwrites ID3v2
+        auto setIfEmpty = [&value](String& target) { if (target.isEmpty()) target = value; };
+
+        switch (field)
+        {
+        case Field::title:  setIfEmpty(tags.title); break;
+        case Field::artist: setIfEmpty(tags.artist); break;
+        case Field::album:  setIfEmpty(tags.album); break;
+        case Field::genre:  setIfEmpty(tags.genre); break;
+        case Field::key:    setIfEmpty(tags.key); break;
+        case Field::bpm:
+            if (tags.bpm <= 0.0)
+                tags.bpm = jmax(0.0, value.getDoubleValue());
+            break;
+        case Field::none: break;
+        }
+    }
+
+    bool readExactly(InputStream& in, void* dest, int numBytes)
+    {
+        return in.read(dest, numBytes) == numBytes;
+    }
+
+    uint32 readSyncSafe(const uint8* d)
+    {
+        return ((uint32) (d[0] & 0x7f) << 21) | ((uint32) (d[1] & 0x7f) << 14) | ((uint32) (d[2] & 0x7f) << 7) | (uint32) (d[3] & 0x7f);
+    }
+
+    uint32 readBigEndian(const uint8* d, int numBytes)
+    {
+        uint32 value = 0;
+        for (int i = 0; i < numBytes; ++i)
+            value = (value << 8) | d[i];
+        return value;
+    }
+
+    //==============================================================================
+    String decodeLatin1(const uint8* d, size_t n)
+    {
+        String result;
+        result.preallocateBytes(n);
+
+        for (size_t i = 0; i < n && d[i] != 0; ++i)
+            result += (juce_wchar) d[i];
+
+        return result;
+    }
+
+    String decodeUtf8(const uint8* d, size_t n)
+    {
+        size_t length = 0;
+        while (length < n && d[length] != 0)
+            ++length;
+
+        return String::fromUTF8((const char*) d, (int) length);
+    }
+
+    String decodeUtf16(const uint8* d, size_t n, bool bigEndian)
+    {
+        std::vector<juce_wchar> chars;
+        chars.reserve(n / 2 + 1);
+
+        auto unitAt = [d, bigEndian](size_t i) -> uint32
+        {
+            return bigEndian ? (uint32) ((d[i] << 8) | d[i + 1]) : (uint32) ((d[i + 1] << 8) | d[i]);
+        };
+
+        for (size_t i = 0; i + 1 < n; i += 2)
+        {
+            uint32 unit = unitAt(i);
+            if (unit == 0)
+                break;
+
+            if (unit >= 0xd800 && unit < 0xdc00 && i + 3 < n)
+            {
+                const uint32 low = unitAt(i + 2);
+                if (low >= 0xdc00 && low < 0xe000)
+                {
+                    unit = 0x10000 + ((unit - 0xd800) << 10) + (low - 0xdc00);
+                    i += 2;
+                }
+            }
+
+            chars.push_back((juce_wchar) unit);
+        }
+
+        chars.push_back(0);
+        return String(CharPointer_UTF32(chars.data()));
+    }
+
+    /** Text frame body: one encoding byte, then the string (only the first of a v2.4 multi-value list is kept) */
+    String decodeId3Text(const uint8* d, size_t n)
+    {
+        if (n < 1)
+            return {};
+
+        const uint8 encoding = d[0];
+        ++d;
+        --n;
+
+        switch (encoding)
+        {
+        case 0: return decodeLatin1(d, n).trim();
+        case 3: return decodeUtf8(d, n).trim();
+        case 2: return decodeUtf16(d, n, true).trim();
+        case 1:
+            if (n >= 2 && d[0] == 0xfe && d[1] == 0xff) return decodeUtf16(d + 2, n - 2, true).trim();
+            if (n >= 2 && d[0] == 0xff && d[1] == 0xfe) return decodeUtf16(d + 2, n - 2, false).trim();
+            return decodeUtf16(d, n, false).trim();
+        default: return {};
+        }
+    }
+
+    /** Remove the zero byte that unsynchronisation inserts after every 0xff */
+    MemoryBlock removeUnsynchronisation(const uint8* d, size_t n)
+    {
+        MemoryBlock result(n);
+        auto* out = static_cast<uint8*>(result.getData());
+        size_t length = 0;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[length++] = d[i];
+            if (d[i] == 0xff && i + 1 < n && d[i + 1] == 0)
+                ++i;
+        }
+
+        result.setSize(length);
+        return result;
+    }
+
+    //==============================================================================
+    const char* const id3v1Genres[] =
+    {
+        "Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk", "Grunge", "Hip-Hop", "Jazz", "Metal",
+        "New Age", "Oldies", "Other", "Pop", "R&B", "Rap", "Reggae", "Rock", "Techno", "Industrial",
+        "Alternative", "Ska", "Death Metal", "Pranks", "Soundtrack", "Euro-Techno", "Ambient", "Trip-Hop", "Vocal", "Jazz+Funk",
+        "Fusion", "Trance", "Classical", "Instrumental", "Acid", "House", "Game", "Sound Clip", "Gospel", "Noise",
+        "Alternative Rock", "Bass", "Soul", "Punk", "Space", "Meditative", "Instrumental Pop", "Instrumental Rock", "Ethnic", "Gothic",
+        "Darkwave", "Techno-Industrial", "Electronic", "Pop-Folk", "Eurodance", "Dream", "Southern Rock", "Comedy", "Cult", "Gangsta",
+        "Top 40", "Christian Rap", "Pop/Funk", "Jungle", "Native American", "Cabaret", "New Wave", "Psychedelic", "Rave", "Showtunes",
+        "Trailer", "Lo-Fi", "Tribal", "Acid Punk", "Acid Jazz", "Polka", "Retro", "Musical", "Rock & Roll", "Hard Rock"
+    };
+
+    String genreFromIndex(int index)
+    {
+        return isPositiveAndBelow(index, (int) numElementsInArray(id3v1Genres)) ? String(id3v1Genres[index]) : String();
+    }
+
+    /** TCON holds free text, a bare ID3v1 index ("17") or a bracketed one with an optional refinement ("(17)Rock") */
+    String resolveId3Genre(const String& text)
+    {
+        if (text.startsWithChar('(') && text.containsChar(')'))
+        {
+            const String refinement = text.fromFirstOccurrenceOf(")", false, false).trim();
+            if (refinement.isNotEmpty())
+                return refinement;
+
+            const String index = text.substring(1).upToFirstOccurrenceOf(")", false, false);
+            if (index.containsOnly("0123456789") && index.isNotEmpty())
+                return genreFromIndex(index.getIntValue());
+        }
+
+        if (text.containsOnly("0123456789") && text.isNotEmpty())
+            return genreFromIndex(text.getIntValue());
+
+        return text;
+    }
+
+    //==============================================================================
+    Field id3FrameField(const char* id, int version)
+    {
+        struct Mapping { const char* v22; const char* v23; Field field; };
+        static const Mapping mappings[] =
+        {
+            { "TT2", "TIT2", Field::title },
+            { "TP1", "TPE1", Field::artist },
+            { "TAL", "TALB", Field::album },
+            { "TCO", "TCON", Field::genre },
+            { "TBP", "TBPM", Field::bpm },
+            { "TKE", "TKEY", Field::key }
+        };
+
+        for (const auto& m : mappings)
+            if (version == 2 ? std::memcmp(id, m.v22, 3) == 0 : std::memcmp(id, m.v23, 4) == 0)
+                return m.field;
+
+        return Field::none;
+    }
+
+    void parseId3v2Frames(InputStream& in, int version, uint8 tagFlags, int64 tagSize, TrackTags& tags)
+    {
+        const int64 end = in.getPosition() + tagSize;
+
+        if ((tagFlags & 0x40) != 0)
+        {
+            // v2.2 used this bit for compression, which nobody implemented
+            if (version == 2)
+                return;
+
+            uint8 sizeBytes[4];
+            if (!readExactly(in, sizeBytes, 4))
+                return;
+
+            // v2.3 counts the extended header without its size field, v2.4 with it
+            if (version == 3)
+                in.skipNextBytes(readBigEndian(sizeBytes, 4));
+            else
+                in.skipNextBytes((int64) readSyncSafe(sizeBytes) - 4);
+        }
+
+        const int headerSize = version == 2 ? 6 : 10;
+
+        while (in.getPosition() + headerSize <= end)
+        {
+            uint8 header[10];
+            if (!readExactly(in, header, headerSize) || header[0] == 0) // Zero bytes start the padding
+                return;
+
+            const int64 frameSize = version == 2 ? readBigEndian(header + 3, 3)
+                                  : version == 3 ? readBigEndian(header + 4, 4)
+                                  : readSyncSafe(header + 4);
+            const int64 frameEnd = in.getPosition() + frameSize;
+
+            if (frameEnd > end)
+                return;
+
+            const Field field = id3FrameField((const char*) header, version);
+            const uint8 formatFlags = version == 2 ? 0 : header[9];
+
+            // Compressed or encrypted frames are skipped along with everything we don't display
+            const bool unreadable = version == 3 ? (formatFlags & 0xc0) != 0 : (formatFlags & 0x0c) != 0;
+
+            if (field != Field::none && !unreadable && frameSize > 0 && frameSize <= maxTextFrameBytes)
+            {
+                HeapBlock<uint8> body((size_t) frameSize);
+                if (!readExactly(in, body, (int) frameSize))
+                    return;
+
+                size_t offset = 0;
+                if (version == 3 && (formatFlags & 0x20) != 0) offset += 1; // Group id
+                if (version == 4 && (formatFlags & 0x40) != 0) offset += 1; // Group id
+                if (version == 4 && (formatFlags & 0x01) != 0) offset += 4; // Data length indicator
+
+                if (offset < (size_t) frameSize)
+                {
+                    String text;
+
+                    if (version == 4 && (formatFlags & 0x02) != 0)
+                    {
+                        const auto clean = removeUnsynchronisation(body + offset, (size_t) frameSize - offset);
+                        text = decodeId3Text(static_cast<const uint8*>(clean.getData()), clean.getSize());
+                    }
+                    else
+                    {
+                        text = decodeId3Text(body + offset, (size_t) frameSize - offset);
+                    }
+
+                    assign(tags, field, field == Field::genre ? resolveId3Genre(text) : text);
+                }
+            }
+
+            in.setPosition(frameEnd);
+        }
+    }
+
+    /** Parse an ID3v2 tag at the stream position and return its total length, or 0 if there isn't one */
+    int64 parseId3v2(InputStream& in, TrackTags& tags)
+    {
+        const int64 start = in.getPosition();
+
+        uint8 header[10];
+        if (!readExactly(in, header, 10) || std::memcmp(header, "ID3", 3) != 0)
+            return 0;
+
+        const int version = header[3];
+        const uint8 flags = header[5];
+        const int64 tagSize = readSyncSafe(header + 6);
+        const int64 totalSize = 10 + tagSize + ((version == 4 && (flags & 0x10) != 0) ? 10 : 0);
+
+        if (version < 2 || version > 4)
+            return totalSize;
+
+        if ((flags & 0x80) != 0 && version < 4)
+        {
+            // Before v2.4 unsynchronisation covers the frame headers too, so undo it over the whole tag
+            if (tagSize <= maxUnsynchronisedTagBytes)
+            {
+                MemoryBlock raw;
+                if (in.readIntoMemoryBlock(raw, (ssize_t) tagSize) == (size_t) tagSize)
+                {
+                    const auto clean = removeUnsynchronisation(static_cast<const uint8*>(raw.getData()), raw.getSize());
+                    MemoryInputStream tagStream(clean, false);
+                    parseId3v2Frames(tagStream, version, flags, (int64) clean.getSize(), tags);
+                }
+            }
+        }
+        else
+        {
+            parseId3v2Frames(in, version, flags, tagSize, tags);
+        }
+
+        in.setPosition(start + totalSize);
+        return totalSize;
+    }
+
+    void parseId3v1(InputStream& in, TrackTags& tags)
+    {
+        const int64 length = in.getTotalLength();
+        if (length < 128 || !in.setPosition(length - 128))
+            return;
+
+        uint8 tag[128];
+        if (!readExactly(in, tag, 128) || std::memcmp(tag, "TAG", 3) != 0)
+            return;
+
+        assign(tags, Field::title, decodeLatin1(tag + 3, 30).trim());
+        assign(tags, Field::artist, decodeLatin1(tag + 33, 30).trim());
+        assign(tags, Field::album, decodeLatin1(tag + 63, 30).trim());
+        assign(tags, Field::genre, genreFromIndex(tag[127]));
+    }
+
+    //==============================================================================
+    Field vorbisCommentField(const String& name)
+    {
+        if (name.equalsIgnoreCase("TITLE")) return Field::title;
+        if (name.equalsIgnoreCase("ARTIST")) return Field::artist;
+        if (name.equalsIgnoreCase("ALBUM")) return Field::album;
+        if (name.equalsIgnoreCase("GENRE")) return Field::genre;
+        if (name.equalsIgnoreCase("BPM") || name.equalsIgnoreCase("TEMPO")) return Field::bpm;
+        if (name.equalsIgnoreCase("INITIALKEY") || name.equalsIgnoreCase("KEY")) return Field::key;
+        return Field::none;
+    }
+
+    /** Vendor string, then a count of NAME=value comments, all with little-endian 32-bit lengths */
+    void parseVorbisComment(const uint8* d, size_t n, TrackTags& tags)
+    {
+        size_t pos = 0;
+
+        auto readLength = [&](uint32& value)
+        {
+            if (pos + 4 > n)
+                return false;
+
+            value = ByteOrder::littleEndianInt(d + pos);
+            pos += 4;
+            return true;
+        };
+
+        uint32 vendorLength = 0, count = 0;
+        if (!readLength(vendorLength) || vendorLength > n - pos)
+            return;
+
+        pos += vendorLength;
+        if (!readLength(count))
+            return;
+
+        for (uint32 i = 0; i < count; ++i)
+        {
+            uint32 length = 0;
+            if (!readLength(length) || length > n - pos)
+                return; // Truncated by maxCommentBlockBytes; keep what we have
+
+            const char* comment = (const char*) d + pos;
+            pos += length;
+
+            const auto* equals = static_cast<const char*>(std::memchr(comment, '=', length));
+            if (equals == nullptr || equals == comment)
+                continue;
+
+            const Field field = vorbisCommentField(String(comment, (size_t) (equals - comment)));
+            if (field != Field::none)
+                assign(tags, field, String::fromUTF8(equals + 1, (int) (comment + length - equals - 1)).trim());
+        }
+    }
+
+    void parseFlac(InputStream& in, TrackTags& tags)
+    {
+        for (;;)
+        {
+            uint8 header[4];
+            if (!readExactly(in, header, 4))
+                return;
+
+            const bool isLast = (header[0] & 0x80) != 0;
+            const int type = header[0] & 0x7f;
+            const int length = (int) readBigEndian(header + 1, 3);
+
+            if (type == 4) // VORBIS_COMMENT
+            {
+                MemoryBlock block;
+                const auto got = in.readIntoMemoryBlock(block, jmin(length, maxCommentBlockBytes));
+                parseVorbisComment(static_cast<const uint8*>(block.getData()), got, tags);
+                return;
+            }
+
+            if (isLast || !in.setPosition(in.getPosition() + length))
+                return;
+        }
+    }
+
+    void parseOggCommentPacket(const MemoryBlock& packet, TrackTags& tags)
+    {
+        const auto* d = static_cast<const uint8*>(packet.getData());
+        const size_t n = packet.getSize();
+
+        if (n >= 7 && std::memcmp(d, "\x03vorbis", 7) == 0)
+            parseVorbisComment(d + 7, n - 7, tags);
+        else if (n >= 8 && std::memcmp(d, "OpusTags", 8) == 0)
+            parseVorbisComment(d + 8, n - 8, tags);
+    }
+
+    /** Reassemble the second packet of the first logical stream, which holds the comments */
+    void parseOgg(InputStream& in, TrackTags& tags)
+    {
+        MemoryBlock packet;
+        int packetIndex = 0;
+        uint32 serial = 0;
+
+        for (int page = 0; page < maxOggPages; ++page)
+        {
+            uint8 header[27];
+            if (!readExactly(in, header, 27) || std::memcmp(header, "OggS", 4) != 0)
+                return;
+
+            const uint32 pageSerial = ByteOrder::littleEndianInt(header + 14);
+            const int numSegments = header[26];
+
+            uint8 lacing[255];
+            if (!readExactly(in, lacing, numSegments))
+                return;
+
+            if (page == 0)
+                serial = pageSerial;
+
+            if (pageSerial != serial)
+            {
+                int pageBytes = 0;
+                for (int s = 0; s < numSegments; ++s)
+                    pageBytes += lacing[s];
+
+                in.skipNextBytes(pageBytes); // Another multiplexed stream
+                continue;
+            }
+
+            for (int s = 0; s < numSegments; ++s)
+            {
+                uint8 segment[255];
+                if (!readExactly(in, segment, lacing[s]))
+                    return;
+
+                if (packetIndex == 1)
+                    packet.append(segment, lacing[s]);
+
+                const bool packetEnds = lacing[s] < 255;
+
+                if (packetIndex == 1 && (packetEnds || (int) packet.getSize() >= maxCommentBlockBytes))
+                {
+                    parseOggCommentPacket(packet, tags);
+                    return;
+                }
+
+                if (packetEnds)
+                    ++packetIndex;
+            }
+        }
+    }
+
+    //==============================================================================
+    /** RIFF INFO text is nominally ASCII, but many taggers write UTF-8 */
+    String decodeRiffText(const uint8* d, size_t n)
+    {
+        if (CharPointer_UTF8::isValidString((const char*) d, (int) n))
+            return decodeUtf8(d, n).trim();
+
+        return decodeLatin1(d, n).trim();
+    }
+
+    void parseRiffInfo(InputStream& in, int64 end, TrackTags& tags)
+    {
+        while (in.getPosition() + 8 <= end)
+        {
+            uint8 header[8];
+            if (!readExactly(in, header, 8))
+                return;
+
+            const uint32 size = ByteOrder::littleEndianInt(header + 4);
+            const int64 next = in.getPosition() + size + (size & 1);
+
+            Field field = Field::none;
+            if (std::memcmp(header, "INAM", 4) == 0) field = Field::title;
+            else if (std::memcmp(header, "IART", 4) == 0) field = Field::artist;
+            else if (std::memcmp(header, "IPRD", 4) == 0) field = Field::album;
+            else if (std::memcmp(header, "IGNR", 4) == 0) field = Field::genre;
+
+            if (field != Field::none && size > 0 && size <= (uint32) maxTextFrameBytes)
+            {
+                HeapBlock<uint8> text(size);
+                if (!readExactly(in, text, (int) size))
+                    return;
+
+                assign(tags, field, decodeRiffText(text, size));
+            }
+
+            in.setPosition(next);
+        }
+    }
+
+    void parseRiff(InputStream& in, TrackTags& tags)
+    {
+        in.setPosition(12);
+
+        for (;;)
+        {
+            uint8 header[8];
+            if (!readExactly(in, header, 8))
+                return;
+
+            const uint32 size = ByteOrder::littleEndianInt(header + 4);
+            const int64 next = in.getPosition() + size + (size & 1);
+
+            if (std::memcmp(header, "LIST", 4) == 0)
+            {
+                uint8 listType[4];
+                if (readExactly(in, listType, 4) && std::memcmp(listType, "INFO", 4) == 0)
+                    parseRiffInfo(in, next, tags);
+            }
+            else if (std::memcmp(header, "id3 ", 4) == 0 || std::memcmp(header, "ID3 ", 4) == 0)
+            {
+                parseId3v2(in, tags);
+            }
+
+            if (!in.setPosition(next))
+                return;
+        }
+    }
+}
+
+//==============================================================================
+TrackTags TagReader::read(const File& file)
+{
+    FileInputStream fileStream(file);
+
+    if (fileStream.failedToOpen())
+        return {};
+
+    // The tag blocks are read in small pieces, so buffer them to keep the system calls down
+    BufferedInputStream buffered(fileStream, 8192);
+    return read(buffered);
+}
+
+TrackTags TagReader::read(InputStream& in)
+{
+    TrackTags tags;
+
+    uint8 magic[12] = {};
+    if (in.read(magic, 12) < 4)
+        return tags;
+
+    in.setPosition(0);
+
+    if (std::memcmp(magic, "ID3", 3) == 0)
+    {
+        // Usually MP3, though some taggers put ID3v2 in front of FLAC too
+        parseId3v2(in, tags);
+
+        uint8 next[4];
+        if (readExactly(in, next, 4) && std::memcmp(next, "fLaC", 4) == 0)
+            parseFlac(in, tags);
+        else
+            parseId3v1(in, tags);
+    }
+    else if (std::memcmp(magic, "fLaC", 4) == 0)
+    {
+        in.setPosition(4);
+        parseFlac(in, tags);
+    }
+    else if (std::memcmp(magic, "OggS", 4) == 0)
+    {
+        parseOgg(in, tags);
+    }
+    else if (std::memcmp(magic, "RIFF", 4) == 0 && std::memcmp(magic + 8, "WAVE", 4) == 0)
+    {
+        parseRiff(in, tags);
+    }
+    else
+    {
+        // An MP3 without ID3v2 may still have the old fixed-size tag at the end
+        parseId3v1(in, tags);
+    }
+
+    return tags;
+}
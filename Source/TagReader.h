@@ -0,0 +1,33 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+/** Metadata read from a file's tags. Fields the file doesn't carry are left empty. */
+struct TrackTags
+{
+    String title;
+    String artist;
+    String album;
+    String genre;
+    String key;      // Musical key as tagged, e.g. "Am" or "8A"
+    double bpm = 0.0; // 0 when the file has no tempo tag
+};
+
+//==============================================================================
+/**
+ * Reads track metadata by parsing tag bytes directly, without opening a decoder.
+ *
+ * Supported: ID3v2.2-2.4 (with an ID3v1 fallback) in MP3, Vorbis comments in FLAC
+ * and Ogg Vorbis/Opus, and RIFF INFO or an embedded ID3v2 chunk in WAV. Only the
+ * tag blocks are read; audio data, cover art and other large frames are seeked
+ * over, so a typical file costs one or two small reads.
+ */
+namespace TagReader
+{
+    /** Read the tags of a file, identified by its leading bytes rather than its extension. */
+    TrackTags read(const File& file);
+
+    /** As above, from a seekable stream positioned at the start of the file. */
+    TrackTags read(InputStream& stream);
+}
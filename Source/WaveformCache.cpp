@@ -0,0 +1,137 @@
+#include "WaveformCache.h"
+
+namespace
+{
+    constexpr int64 fingerprintBytes = 64 * 1024;
+    const char* const entryExtension = ".wfp";
+
+    /** 64-bit FNV-1a */
+    uint64 hashBytes(uint64 hash, const void* data, size_t numBytes)
+    {
+        const auto* bytes = static_cast<const uint8*>(data);
+
+        for (size_t i = 0; i < numBytes; ++i)
+            hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+
+        return hash;
+    }
+
+    /** Hash the start and end of the file, enough to tell re-encodes and retags apart without reading it all */
+    uint64 hashFileContents(uint64 hash, const File& file)
+    {
+        FileInputStream in(file);
+
+        if (!in.openedOk())
+            return hash;
+
+        HeapBlock<char> chunk((size_t) fingerprintBytes);
+        const int64 size = in.getTotalLength();
+
+        for (const int64 start : { (int64) 0, jmax((int64) 0, size - fingerprintBytes) })
+        {
+            in.setPosition(start);
+            const int numRead = in.read(chunk.getData(), (int) fingerprintBytes);
+            hash = hashBytes(hash, chunk.getData(), (size_t) jmax(0, numRead));
+        }
+
+        return hash;
+    }
+}
+
+//==============================================================================
+WaveformCache::WaveformCache(const File& dir, int64 maxSize)
+    : directory(dir), maxSizeBytes(maxSize)
+{
+    directory.createDirectory();
+}
+
+File WaveformCache::getDefaultDirectory()
+{
+    return File::getSpecialLocation(File::SpecialLocationType::userApplicationDataDirectory)
+        .getChildFile(ProjectInfo::projectName)
+        .getChildFile("WaveformCache");
+}
+
+File WaveformCache::getEntryFor(const File& audioFile) const
+{
+    const String path = audioFile.getFullPathName();
+    const int64 size = audioFile.getSize();
+    const int64 modified = audioFile.getLastModificationTime().toMilliseconds();
+
+    uint64 hash = 0xcbf29ce484222325ULL;
+    hash = hashBytes(hash, path.toRawUTF8(), path.getNumBytesAsUTF8());
+    hash = hashBytes(hash, &size, sizeof(size));
+    hash = hashBytes(hash, &modified, sizeof(modified));
+    hash = hashFileContents(hash, audioFile);
+
+    return directory.getChildFile(String::toHexString((int64) hash) + entryExtension);
+}
+
+//==============================================================================
+WaveformPyramid::Ptr WaveformCache::load(const File& audioFile) const
+{
+    if (!audioFile.existsAsFile())
+        return nullptr;
+
+    const File entry = getEntryFor(audioFile);
+
+    if (!entry.existsAsFile())
+        return nullptr;
+
+    MemoryMappedFile mapped(entry, MemoryMappedFile::readOnly);
+    auto pyramid = WaveformPyramid::createFromMemory(mapped.getData(), mapped.getSize());
+
+    if (pyramid != nullptr)
+        entry.setLastAccessTime(Time::getCurrentTime()); // Keeps the entry at the young end of the LRU order
+    else
+        entry.deleteFile(); // Written by an older build, or truncated
+
+    return pyramid;
+}
+
+void WaveformCache::store(const File& audioFile, const WaveformPyramid& pyramid)
+{
+    if (!pyramid.isComplete())
+        return;
+
+    const File entry = getEntryFor(audioFile);
+    const ScopedLock sl(writeLock);
+
+    // Write beside the entry and swap it in, so a concurrent load never maps a half-written file
+    TemporaryFile temp(entry);
+    {
+        FileOutputStream out(temp.getFile());
+
+        if (!out.openedOk() || !pyramid.writeTo(out))
+            return;
+    }
+
+    if (temp.overwriteTargetFileWithTemporary())
+        evictToSizeCap();
+}
+
+void WaveformCache::evictToSizeCap()
+{
+    auto entries = directory.findChildFiles(File::findFiles, false, String("*") + entryExtension);
+
+    int64 total = 0;
+    for (const auto& f : entries)
+        total += f.getSize();
+
+    if (total <= maxSizeBytes)
+        return;
+
+    std::sort(entries.begin(), entries.end(), [](const File& a, const File& b)
+        {
+            return a.getLastAccessTime() < b.getLastAccessTime();
+        });
+
+    for (const auto& f : entries)
+    {
+        if (total <= maxSizeBytes)
+            break;
+
+        total -= f.getSize();
+        f.deleteFile();
+    }
+}
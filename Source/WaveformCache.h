@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "WaveformPyramid.h"
+
+//==============================================================================
+/**
+ * Disk-backed store of analysed waveforms, so a track only has to be decoded for
+ * drawing the first time it is ever loaded.
+ *
+ * Each entry is one file named after a fingerprint of the track: its path, size,
+ * modification time and a hash of its first and last 64 KB. Editing or replacing
+ * the track therefore changes the key, and the stale entry simply ages out.
+ * Entries are read back through a memory mapping. Once the directory grows past
+ * the size cap, the least recently used entries are deleted.
+ */
+class WaveformCache
+{
+public:
+    explicit WaveformCache(const File& directory = getDefaultDirectory(), int64 maxSizeBytes = defaultMaxSizeBytes);
+
+    /** The cached waveform for this file, or null if it has never been analysed (or has changed since). */
+    WaveformPyramid::Ptr load(const File& audioFile) const;
+
+    /** Save a completed pyramid and trim the cache back under its size cap. Safe to call from any thread. */
+    void store(const File& audioFile, const WaveformPyramid& pyramid);
+
+    static File getDefaultDirectory();
+    static constexpr int64 defaultMaxSizeBytes = 256 * 1024 * 1024;
+
+private:
+    File getEntryFor(const File& audioFile) const;
+    void evictToSizeCap();
+
+    const File directory;
+    const int64 maxSizeBytes;
+    CriticalSection writeLock; // Serialises stores and eviction from different analysis threads
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformCache)
+};
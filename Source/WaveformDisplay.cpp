@@ -10,16 +10,18 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "WaveformDisplay.h"
+#include "PaintProfiler.h"
 
 //==============================================================================
 WaveformDisplay::WaveformDisplay(AudioFormatManager& formatManagerToUse,
-    AudioThumbnailCache& cacheToUse,
+    WaveformCache& cacheToUse,
     Slider* posSlider,
     Colour backgroundColour,
     Colour outlineColour,
     Colour waveformColour,
     Colour playheadColour) :
-    audioThumb(1000, formatManagerToUse, cacheToUse),
+    formatManager(formatManagerToUse),
+    cache(cacheToUse),
     fileLoaded(false),
     position(0.0),
     posSlider(posSlider),
@@ -27,17 +29,36 @@ WaveformDisplay::WaveformDisplay(AudioFormatManager& formatManagerToUse,
     outlineColour(outlineColour),
     waveformColour(waveformColour),
     playheadColour(playheadColour) // Initialize new member variables
-{   
-    audioThumb.addChangeListener(this);
+{
+    setOpaque(true); // The cached background covers every pixel
 }
 
 WaveformDisplay::~WaveformDisplay()
 {
-    audioThumb.removeChangeListener(this); // Remove the listener in the destructor
+    analysisPool.removeAllJobs(true, 4000); // Stop any analysis still writing into the pyramid
 }
 
 void WaveformDisplay::paint(Graphics& g)
 {
+    OTODECKS_PROFILE_PAINT("WaveformDisplay::paint");
+    if (!backgroundValid || background.getWidth() != getWidth() || background.getHeight() != getHeight())
+        renderBackground();
+
+    // Usually only a playhead-sized strip is being repainted, and the blit is clipped to it
+    g.drawImageAt(background, 0, 0);
+
+    if (fileLoaded)
+    {
+        g.setColour(playheadColour.withAlpha(0.8f));
+        g.fillRect(getPlayheadArea(position));
+    }
+}
+
+void WaveformDisplay::renderBackground()
+{
+    background = Image(Image::RGB, jmax(1, getWidth()), jmax(1, getHeight()), false);
+    Graphics g(background);
+
     g.fillAll(backgroundColour); // Clear the background
 
     g.setColour(outlineColour);
@@ -46,17 +67,14 @@ void WaveformDisplay::paint(Graphics& g)
     g.setColour(waveformColour);
     if (fileLoaded)
     {
-        audioThumb.drawChannel(g,
-            getLocalBounds(),
-            0,
-            audioThumb.getTotalLength(),
-            0,
-            1.0f
-        );
-
-        // Draw playhead
-        g.setColour(playheadColour.withAlpha(0.8f));
-        g.fillRect(position * getWidth(), 0, getWidth() / 150, getHeight());
+        // One pyramid lookup per pixel column, whatever the track length
+        pyramid->draw(g, getLocalBounds(), 0.0, (double) pyramid->getLengthInSamples(), waveformColour);
+
+        // Bars and cues go into the cached image too, so they cost nothing per frame
+        const double samplesPerPixel = (double) pyramid->getLengthInSamples() / jmax(1, getWidth());
+        gridOverlay.update(pyramid->getBeatGrid(), pyramid->getSampleRate(), samplesPerPixel, pyramid->getLengthInSamples());
+        gridOverlay.draw(g, getLocalBounds(), 0, Colours::white);
+        BeatGridOverlay::drawCues(g, getLocalBounds(), 0, getWidth(), cuePositions);
     }
     else
     {
@@ -64,17 +82,52 @@ void WaveformDisplay::paint(Graphics& g)
         g.drawText("File not loaded...", getLocalBounds(),
             Justification::centred, true); // Draw some placeholder text
     }
+
+    backgroundValid = true;
+}
+
+Rectangle<int> WaveformDisplay::getPlayheadArea(double pos) const
+{
+    return { roundToInt(pos * getWidth()), 0, jmax(1, getWidth() / 150), getHeight() };
+}
+
+void WaveformDisplay::setCuePoints(const Array<double>& positions)
+{
+    if (positions == cuePositions)
+        return;
+
+    cuePositions = positions;
+    backgroundValid = false;
+    repaint();
 }
 
 void WaveformDisplay::resized()
 {
-    // This method is where you should set the bounds of any child components that your component contains..
+    backgroundValid = false;
 }
 
 void WaveformDisplay::loadURL(URL audioURL)
 {
-    audioThumb.clear();
-    fileLoaded = audioThumb.setSource(new URLInputSource(audioURL));
+    analysisPool.removeAllJobs(true, 4000);
+
+    const File file = audioURL.getLocalFile();
+
+    // Tracks seen before come straight from the disk cache; anything else is analysed in the background
+    pyramid = cache.load(file);
+
+    if (pyramid == nullptr)
+    {
+        pyramid = WaveformAnalysisJob::createPyramidFor(formatManager, file);
+
+        if (pyramid != nullptr)
+        {
+            analysisPool.addJob(new WaveformAnalysisJob(formatManager, file, pyramid, &cache), true);
+            startTimerHz(15);
+        }
+    }
+
+    fileLoaded = pyramid != nullptr;
+    backgroundValid = false;
 
     if (fileLoaded)
     {
@@ -87,18 +140,26 @@ void WaveformDisplay::loadURL(URL audioURL)
     }
 }
 
-void WaveformDisplay::changeListenerCallback(ChangeBroadcaster* source)
+void WaveformDisplay::timerCallback()
 {
-    std::cout << "wfd: change received! " << std::endl;
+    if (pyramid == nullptr || pyramid->isComplete())
+        stopTimer();
+
+    backgroundValid = false;
     repaint();
 }
 
 void WaveformDisplay::setPositionRelative(double pos)
 {
-    if (pos != position)
+    const auto oldArea = getPlayheadArea(position);
+    const auto newArea = getPlayheadArea(pos);
+    position = pos;
+
+    // Only the strips under the old and new playhead need redrawing, and only once it has moved a pixel
+    if (newArea != oldArea)
     {
-        position = pos;
-        repaint();
+        repaint(oldArea);
+        repaint(newArea);
     }
 }
 
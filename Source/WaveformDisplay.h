@@ -2,15 +2,17 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "DJAudioPlayer.h"
+#include "WaveformPyramid.h"
+#include "WaveformCache.h"
 //==============================================================================
 /*
 */
 class WaveformDisplay : public Component,
-    public ChangeListener, public MouseListener, public ChangeBroadcaster
+    public MouseListener, public ChangeBroadcaster, private Timer
 {
 public:
     WaveformDisplay(AudioFormatManager& formatManagerToUse,
-        AudioThumbnailCache& cacheToUse,
+        WaveformCache& cacheToUse,
         Slider* posSlider,
         Colour backgroundColour = Colours::black,
         Colour outlineColour = Colours::grey,
@@ -22,10 +24,14 @@ public:
     void paint(Graphics&) override;
     void resized() override;
 
-    void changeListenerCallback(ChangeBroadcaster* source) override;
-
     void loadURL(URL audioURL);
 
+    /** The summary being drawn; may still be filling in on the analysis thread. */
+    WaveformPyramid::Ptr getPyramid() const { return pyramid; }
+
+    /** Relative hot-cue positions to mark, negative for unset */
+    void setCuePoints(const Array<double>& positions);
+
     /** set the relative position of the playhead*/
     void setPositionRelative(double pos);
 
@@ -41,7 +47,21 @@ public:
 
 
 private:
-    AudioThumbnail audioThumb;
+    /** Repaints while the analysis thread streams in more of the waveform */
+    void timerCallback() override;
+
+    /** Draw everything but the playhead into the cached background image */
+    void renderBackground();
+    Rectangle<int> getPlayheadArea(double pos) const;
+
+    AudioFormatManager& formatManager;
+    WaveformCache& cache;
+    ThreadPool analysisPool{ 1 };
+    WaveformPyramid::Ptr pyramid;
+    Image background; // Outline and waveform, redrawn only when the track, size or analysis changes
+    bool backgroundValid = false;
+    BeatGridOverlay gridOverlay;
+    Array<double> cuePositions;
     bool fileLoaded;
     double position;
     Slider* posSlider;
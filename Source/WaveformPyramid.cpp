@@ -0,0 +1,361 @@
+#include "WaveformPyramid.h"
+#include "LoudnessAnalyser.h"
+#include "WaveformCache.h"
+
+//==============================================================================
+WaveformPyramid::Point WaveformPyramid::Level::get(int index) const
+{
+    const auto i = (size_t) index;
+    return { fields[minField][i], fields[maxField][i], fields[meanSquareField][i],
+             fields[lowField][i], fields[midField][i], fields[highField][i] };
+}
+
+void WaveformPyramid::Level::set(int index, const Point& point)
+{
+    const auto i = (size_t) index;
+    fields[minField][i] = point.min;
+    fields[maxField][i] = point.max;
+    fields[meanSquareField][i] = point.meanSquare;
+    fields[lowField][i] = point.low;
+    fields[midField][i] = point.mid;
+    fields[highField][i] = point.high;
+}
+
+Colour WaveformPyramid::Peak::getBandColour() const
+{
+    const float loudest = jmax(lowRms, midRms, highRms);
+
+    if (loudest <= 0.0f)
+        return Colours::transparentBlack;
+
+    // Normalise so the dominant band is at full brightness, whatever the level
+    return Colour::fromFloatRGBA(lowRms / loudest, midRms / loudest, highRms / loudest, 1.0f);
+}
+
+//==============================================================================
+WaveformPyramid::WaveformPyramid(int64 length, double rate)
+    : lengthInSamples(jmax((int64) 0, length)), sampleRate(rate)
+{
+    int points = (int) ((lengthInSamples + baseSamplesPerPoint - 1) / baseSamplesPerPoint);
+
+    // Keep halving until a single point covers the whole track
+    numLevels = 1;
+    for (int n = points; n > 1; n = (n + 1) / 2)
+        ++numLevels;
+
+    levels.reset(new Level[(size_t) numLevels]);
+
+    for (int i = 0; i < numLevels; ++i)
+    {
+        for (auto& field : levels[i].fields)
+            field.resize((size_t) points);
+
+        points = (points + 1) / 2;
+    }
+}
+
+void WaveformPyramid::addBasePoint(const Point& point)
+{
+    auto& base = levels[0];
+    const int index = numBasePointsWritten;
+
+    if (index >= (int) base.fields[minField].size())
+        return;
+
+    base.set(index, point);
+    base.numReady.store(index + 1, std::memory_order_release);
+    ++numBasePointsWritten;
+
+    // Every time a pair completes at one level, the point above it can be filled in
+    int completed = index + 1;
+    for (int level = 1; level < numLevels && (completed & 1) == 0; ++level)
+    {
+        completed >>= 1;
+        combineInto(level, completed - 1);
+    }
+}
+
+void WaveformPyramid::finish()
+{
+    // Trailing odd points never completed a pair, so fill the last point of each level from what is there
+    for (int level = 1; level < numLevels; ++level)
+    {
+        const int below = levels[level - 1].numReady.load(std::memory_order_relaxed);
+        for (int i = levels[level].numReady.load(std::memory_order_relaxed); i < (below + 1) / 2; ++i)
+            combineInto(level, i);
+    }
+
+    complete.store(true, std::memory_order_release);
+}
+
+std::vector<float> WaveformPyramid::getBaseLowBand() const
+{
+    const auto& field = levels[0].fields[lowField];
+    return { field.begin(), field.begin() + levels[0].numReady.load(std::memory_order_acquire) };
+}
+
+void WaveformPyramid::combineInto(int level, int index)
+{
+    const auto& below = levels[level - 1];
+    auto& target = levels[level];
+
+    const int first = index * 2;
+    const int last = jmin(first + 1, below.numReady.load(std::memory_order_relaxed) - 1);
+
+    Point point = below.get(first);
+
+    if (last > first)
+    {
+        const Point other = below.get(last);
+        point.min = jmin(point.min, other.min);
+        point.max = jmax(point.max, other.max);
+        point.meanSquare = 0.5f * (point.meanSquare + other.meanSquare);
+        point.low = 0.5f * (point.low + other.low);
+        point.mid = 0.5f * (point.mid + other.mid);
+        point.high = 0.5f * (point.high + other.high);
+    }
+
+    target.set(index, point);
+    target.numReady.store(index + 1, std::memory_order_release);
+}
+
+//==============================================================================
+namespace
+{
+    constexpr int fileMagic = 0x4657544f; // "OTWF" as little-endian bytes
+    constexpr size_t headerSize = 4 + 4 + 8 + 8 + 8 + 8 + 4;
+}
+
+bool WaveformPyramid::writeTo(OutputStream& out) const
+{
+    const auto& base = levels[0];
+    const int numPoints = base.numReady.load(std::memory_order_acquire);
+    const size_t arrayBytes = sizeof(float) * (size_t) numPoints;
+
+    bool ok = out.writeInt(fileMagic)
+        && out.writeInt(formatVersion)
+        && out.writeInt64(lengthInSamples)
+        && out.writeDouble(sampleRate)
+        && out.writeDouble(beatGrid.bpm)
+        && out.writeDouble(beatGrid.firstBeatSeconds)
+        && out.writeInt(numPoints);
+
+    for (const auto& field : base.fields)
+        ok = ok && out.write(field.data(), arrayBytes);
+
+    return ok;
+}
+
+WaveformPyramid::Ptr WaveformPyramid::createFromMemory(const void* data, size_t numBytes)
+{
+    if (data == nullptr || numBytes < headerSize)
+        return nullptr;
+
+    MemoryInputStream header(data, headerSize, false);
+
+    if (header.readInt() != fileMagic || header.readInt() != formatVersion)
+        return nullptr;
+
+    const int64 length = header.readInt64();
+    const double rate = header.readDouble();
+    BeatGrid grid;
+    grid.bpm = header.readDouble();
+    grid.firstBeatSeconds = header.readDouble();
+    const int numPoints = header.readInt();
+    const size_t arrayBytes = sizeof(float) * (size_t) jmax(0, numPoints);
+
+    if (length <= 0 || numBytes < headerSize + arrayBytes * numFields)
+        return nullptr;
+
+    Ptr pyramid(new WaveformPyramid(length, rate));
+    auto& base = pyramid->levels[0];
+
+    if ((size_t) numPoints != base.fields[minField].size())
+        return nullptr;
+
+    // The arrays are copied straight out of the mapping; only the upper levels need computing
+    const char* arrays = static_cast<const char*>(data) + headerSize;
+
+    for (int i = 0; i < numFields; ++i)
+        std::memcpy(base.fields[i].data(), arrays + arrayBytes * (size_t) i, arrayBytes);
+
+    base.numReady.store(numPoints, std::memory_order_relaxed);
+    pyramid->numBasePointsWritten = numPoints;
+    pyramid->setBeatGrid(grid);
+    pyramid->finish();
+
+    return pyramid;
+}
+
+//==============================================================================
+WaveformPyramid::Peak WaveformPyramid::getPeak(double startSample, double endSample) const
+{
+    Peak peak;
+    const double span = jmax(1.0, endSample - startSample);
+
+    // Coarsest level whose points are no wider than the requested span
+    int level = 0;
+    while (level + 1 < numLevels && (double) (baseSamplesPerPoint << (level + 1)) <= span)
+        ++level;
+
+    const auto& l = levels[level];
+    const double samplesPerPoint = (double) ((int64) baseSamplesPerPoint << level);
+    const int ready = l.numReady.load(std::memory_order_acquire);
+    const int first = jmax(0, (int) (startSample / samplesPerPoint));
+    const int last = jmin(ready, (int) std::ceil(endSample / samplesPerPoint));
+
+    if (first >= last)
+        return peak;
+
+    peak.min = l.fields[minField][(size_t) first];
+    peak.max = l.fields[maxField][(size_t) first];
+    double meanSquare = 0.0, low = 0.0, mid = 0.0, high = 0.0;
+
+    for (int i = first; i < last; ++i)
+    {
+        const Point point = l.get(i);
+        peak.min = jmin(peak.min, point.min);
+        peak.max = jmax(peak.max, point.max);
+        meanSquare += point.meanSquare;
+        low += point.low;
+        mid += point.mid;
+        high += point.high;
+    }
+
+    const double count = last - first;
+    peak.rms = (float) std::sqrt(meanSquare / count);
+    peak.lowRms = (float) std::sqrt(low / count);
+    peak.midRms = (float) std::sqrt(mid / count);
+    peak.highRms = (float) std::sqrt(high / count);
+    return peak;
+}
+
+void WaveformPyramid::draw(Graphics& g, Rectangle<int> area, double startSample, double endSample, Colour colour) const
+{
+    const int width = area.getWidth();
+    if (width <= 0 || endSample <= startSample)
+        return;
+
+    const float centreY = (float) area.getCentreY();
+    const float halfHeight = area.getHeight() * 0.5f;
+    const double samplesPerPixel = (endSample - startSample) / width;
+
+    for (int x = 0; x < width; ++x)
+    {
+        const double s = startSample + x * samplesPerPixel;
+        const auto peak = getPeak(s, s + samplesPerPixel);
+
+        if (peak.max <= peak.min)
+            continue;
+
+        const float top = centreY - jlimit(-1.0f, 1.0f, peak.max) * halfHeight;
+        const float bottom = centreY - jlimit(-1.0f, 1.0f, peak.min) * halfHeight;
+        const float rms = jmin(1.0f, peak.rms) * halfHeight;
+        const float columnX = (float) (area.getX() + x);
+
+        const Colour bandColour = peak.getBandColour();
+        const Colour columnColour = bandColour.isTransparent() ? colour : bandColour;
+
+        g.setColour(columnColour.withAlpha(0.55f));
+        g.fillRect(columnX, top, 1.0f, jmax(1.0f, bottom - top));
+        g.setColour(columnColour);
+        g.fillRect(columnX, centreY - rms, 1.0f, jmax(1.0f, rms * 2.0f));
+    }
+}
+
+//==============================================================================
+WaveformAnalysisJob::WaveformAnalysisJob(AudioFormatManager& fm, const File& f, WaveformPyramid::Ptr target,
+    WaveformCache* cacheToStoreIn)
+    : ThreadPoolJob("Waveform analysis"), formatManager(fm), file(f), pyramid(std::move(target)), cache(cacheToStoreIn)
+{
+}
+
+WaveformPyramid::Ptr WaveformAnalysisJob::createPyramidFor(AudioFormatManager& formatManager, const File& file)
+{
+    std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+        return nullptr;
+
+    return WaveformPyramid::Ptr(new WaveformPyramid(reader->lengthInSamples, reader->sampleRate));
+}
+
+ThreadPoolJob::JobStatus WaveformAnalysisJob::runJob()
+{
+    std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+    if (reader == nullptr)
+    {
+        pyramid->finish();
+        return jobHasFinished;
+    }
+
+    constexpr int pointsPerChunk = 1024;
+    constexpr int base = WaveformPyramid::baseSamplesPerPoint;
+    const int numChannels = jmin(2, (int) reader->numChannels);
+    AudioBuffer<float> buffer(numChannels, base * pointsPerChunk);
+
+    // Bands are split from the mono sum: low = LP 200 Hz, high = HP 2.5 kHz, mid = whatever is left
+    enum { lowBand, midBand, highBand, numBands };
+    AudioBuffer<float> bands(numBands, buffer.getNumSamples());
+    IIRFilter lowFilter, highFilter;
+    lowFilter.setCoefficients(IIRCoefficients::makeLowPass(reader->sampleRate, 200.0));
+    highFilter.setCoefficients(IIRCoefficients::makeHighPass(reader->sampleRate, 2500.0));
+
+    for (int64 pos = 0; pos < pyramid->getLengthInSamples(); pos += buffer.getNumSamples())
+    {
+        if (shouldExit())
+            return jobHasFinished;
+
+        const int numSamples = (int) jmin((int64) buffer.getNumSamples(), pyramid->getLengthInSamples() - pos);
+        reader->read(&buffer, 0, numSamples, pos, true, numChannels > 1);
+
+        float* low = bands.getWritePointer(lowBand);
+        float* mid = bands.getWritePointer(midBand);
+        float* high = bands.getWritePointer(highBand);
+
+        FloatVectorOperations::copyWithMultiply(mid, buffer.getReadPointer(0), 1.0f / numChannels, numSamples);
+        if (numChannels > 1)
+            FloatVectorOperations::addWithMultiply(mid, buffer.getReadPointer(1), 0.5f, numSamples);
+
+        FloatVectorOperations::copy(low, mid, numSamples);
+        FloatVectorOperations::copy(high, mid, numSamples);
+        lowFilter.processSamples(low, numSamples);
+        highFilter.processSamples(high, numSamples);
+        FloatVectorOperations::subtract(mid, low, numSamples);
+        FloatVectorOperations::subtract(mid, high, numSamples);
+
+        for (int offset = 0; offset < numSamples; offset += base)
+        {
+            const int num = jmin(base, numSamples - offset);
+            WaveformPyramid::Point point;
+            double sumSquares = 0.0;
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                const float* data = buffer.getReadPointer(ch, offset);
+                const auto range = FloatVectorOperations::findMinAndMax(data, num);
+                point.min = ch == 0 ? range.getStart() : jmin(point.min, range.getStart());
+                point.max = ch == 0 ? range.getEnd() : jmax(point.max, range.getEnd());
+                sumSquares += LoudnessKernels::sumOfSquares(data, num);
+            }
+
+            point.meanSquare = (float) (sumSquares / (num * numChannels));
+            point.low = (float) (LoudnessKernels::sumOfSquares(low + offset, num) / num);
+            point.mid = (float) (LoudnessKernels::sumOfSquares(mid + offset, num) / num);
+            point.high = (float) (LoudnessKernels::sumOfSquares(high + offset, num) / num);
+
+            pyramid->addBasePoint(point);
+        }
+    }
+
+    // Tempo comes from the bass envelope, so it costs nothing beyond the analysis already done
+    pyramid->setBeatGrid(BeatGrid::estimate(pyramid->getBaseLowBand(),
+        reader->sampleRate / WaveformPyramid::baseSamplesPerPoint));
+    pyramid->finish();
+
+    if (cache != nullptr)
+        cache->store(file, *pyramid);
+
+    return jobHasFinished;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "BeatGrid.h"
+#include <atomic>
+#include <vector>
+
+class WaveformCache;
+
+//==============================================================================
+/**
+ * Mipmapped min/max/RMS summary of a track. Level 0 holds one point per
+ * baseSamplesPerPoint samples and each level above halves the resolution, so any
+ * zoom can be drawn from the level whose points are about one pixel wide.
+ *
+ * Every point also carries the energy in three frequency bands (split at 200 Hz
+ * and 2.5 kHz), worked out once during analysis, which colours the waveform so
+ * kicks, vocals and hats can be told apart at a glance.
+ *
+ * One analysis thread appends points while the GUI reads them. The storage is
+ * sized up front and never reallocates, and each level publishes how many of its
+ * points are ready through an atomic, so a partially analysed track can be drawn.
+ */
+class WaveformPyramid : public ReferenceCountedObject
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<WaveformPyramid>;
+
+    static constexpr int baseSamplesPerPoint = 64;
+
+    WaveformPyramid(int64 lengthInSamples, double sampleRate);
+
+    int64 getLengthInSamples() const { return lengthInSamples; }
+    double getSampleRate() const { return sampleRate; }
+    int getNumLevels() const { return numLevels; }
+    bool isComplete() const { return complete.load(std::memory_order_acquire); }
+
+    /** One summary point. Everything except min and max is a per-sample mean of x^2. */
+    struct Point
+    {
+        float min = 0.0f;
+        float max = 0.0f;
+        float meanSquare = 0.0f;
+        float low = 0.0f;
+        float mid = 0.0f;
+        float high = 0.0f;
+    };
+
+    struct Peak
+    {
+        float min = 0.0f;
+        float max = 0.0f;
+        float rms = 0.0f;
+        float lowRms = 0.0f;
+        float midRms = 0.0f;
+        float highRms = 0.0f;
+
+        /** Red for bass, green for mids and blue for highs, mixed by each band's share of the energy */
+        Colour getBandColour() const;
+    };
+
+    /** Summary of [startSample, endSample), read from the coarsest level that still resolves it. */
+    Peak getPeak(double startSample, double endSample) const;
+
+    /** Draw samples [startSample, endSample) across the area, one column per pixel, coloured by frequency band.
+        The colour is only used for columns with no band energy to go on. */
+    void draw(Graphics& g, Rectangle<int> area, double startSample, double endSample, Colour colour) const;
+
+    //==============================================================================
+    /** Analysis thread: append the next level-0 point. */
+    void addBasePoint(const Point& point);
+
+    /** Analysis thread: flush the partial points left at the end of every level. */
+    void finish();
+
+    /** Analysis thread: set the tempo grid; call before finish(), which publishes it. */
+    void setBeatGrid(const BeatGrid& grid) { beatGrid = grid; }
+
+    /** The tempo grid, once analysis is complete (invalid until then, or if there was no steady beat). */
+    BeatGrid getBeatGrid() const { return isComplete() ? beatGrid : BeatGrid(); }
+
+    /** Copy of the level-0 bass energy, for tempo estimation */
+    std::vector<float> getBaseLowBand() const;
+
+    //==============================================================================
+    /** Serialise a complete pyramid. Only level 0 is stored; the rest is rebuilt on load. */
+    bool writeTo(OutputStream& out) const;
+
+    /** Rebuild a pyramid from writeTo() output, e.g. a memory-mapped cache file. Null if the data is stale or damaged. */
+    static Ptr createFromMemory(const void* data, size_t numBytes);
+
+    static constexpr int formatVersion = 3; // Bump whenever the point data changes meaning
+
+private:
+    enum Field { minField, maxField, meanSquareField, lowField, midField, highField, numFields };
+
+    struct Level
+    {
+        std::vector<float> fields[numFields];
+        std::atomic<int> numReady{ 0 };
+
+        Point get(int index) const;
+        void set(int index, const Point& point);
+    };
+
+    void combineInto(int level, int index);
+
+    const int64 lengthInSamples;
+    const double sampleRate;
+    int numLevels = 0;
+    std::unique_ptr<Level[]> levels;
+    int numBasePointsWritten = 0; // Analysis thread only
+    std::atomic<bool> complete{ false };
+    BeatGrid beatGrid; // Written before complete is set, read only after
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformPyramid)
+};
+
+//==============================================================================
+/** Decodes a file and streams its points into a WaveformPyramid, saving the result to the cache when it completes. */
+class WaveformAnalysisJob : public ThreadPoolJob
+{
+public:
+    WaveformAnalysisJob(AudioFormatManager& formatManager, const File& file, WaveformPyramid::Ptr target,
+        WaveformCache* cacheToStoreIn = nullptr);
+
+    JobStatus runJob() override;
+
+    /** Open the file just far enough to size a pyramid for it, or return null if it can't be read. */
+    static WaveformPyramid::Ptr createPyramidFor(AudioFormatManager& formatManager, const File& file);
+
+private:
+    AudioFormatManager& formatManager;
+    File file;
+    WaveformPyramid::Ptr pyramid;
+    WaveformCache* cache;
+};
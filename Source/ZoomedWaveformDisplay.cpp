@@ -0,0 +1,137 @@
+#include "ZoomedWaveformDisplay.h"
+#include "PaintProfiler.h"
+
+//==============================================================================
+ZoomedWaveformDisplay::ZoomedWaveformDisplay(DJAudioPlayer& p, Colour waveform, Colour background, Colour playhead)
+    : player(p), waveformColour(waveform), backgroundColour(background), playheadColour(playhead)
+{
+    setOpaque(true);
+}
+
+void ZoomedWaveformDisplay::paint(Graphics& g)
+{
+    OTODECKS_PROFILE_PAINT("ZoomedWaveformDisplay::paint");
+    if (strip.isValid())
+        g.drawImageAt(strip, 0, 0);
+    else
+        g.fillAll(backgroundColour);
+
+    // The playhead stays fixed in the middle while the waveform moves underneath it
+    g.setColour(playheadColour.withAlpha(0.8f));
+    g.fillRect(getWidth() / 2 - 1, 0, 2, getHeight());
+}
+
+void ZoomedWaveformDisplay::resized()
+{
+    stripValid = false;
+}
+
+void ZoomedWaveformDisplay::mouseWheelMove(const MouseEvent&, const MouseWheelDetails& wheel)
+{
+    setVisibleSeconds(visibleSeconds * (wheel.deltaY > 0 ? 0.8 : 1.25));
+}
+
+void ZoomedWaveformDisplay::setPyramid(WaveformPyramid::Ptr newPyramid)
+{
+    pyramid = std::move(newPyramid);
+    stripValid = false;
+}
+
+void ZoomedWaveformDisplay::setVisibleSeconds(double seconds)
+{
+    visibleSeconds = jlimit(1.0, 30.0, seconds);
+    stripValid = false;
+}
+
+void ZoomedWaveformDisplay::setCuePoints(const Array<double>& positions)
+{
+    if (positions == cuePositions)
+        return;
+
+    cuePositions = positions;
+    stripValid = false;
+}
+
+//==============================================================================
+void ZoomedWaveformDisplay::updateAnimation()
+{
+    const int width = getWidth();
+
+    if (pyramid == nullptr || width <= 0 || getHeight() <= 0)
+        return;
+
+    const double spp = visibleSeconds * pyramid->getSampleRate() / width;
+    const double playheadSample = player.getInterpolatedPositionRelative() * pyramid->getLengthInSamples();
+    const int64 origin = (int64) std::floor(playheadSample / spp) - width / 2;
+
+    // While analysis is still streaming in, refresh the whole strip now and then to pick up new points
+    const bool needsRefresh = !stripComplete && ++framesSinceFullRender >= 15;
+
+    if (!stripValid || spp != samplesPerPixel || needsRefresh
+        || strip.getWidth() != width || strip.getHeight() != getHeight())
+    {
+        samplesPerPixel = spp;
+        stripOrigin = origin;
+        renderAll();
+        repaint();
+        return;
+    }
+
+    const int64 shift = origin - stripOrigin;
+
+    if (shift == 0)
+        return;
+
+    if (std::abs(shift) >= width)
+    {
+        stripOrigin = origin;
+        renderAll();
+    }
+    else
+    {
+        const int dx = (int) shift;
+
+        // Slide the cached columns across and only draw the strip that has come into view
+        if (dx > 0)
+            strip.moveImageSection(0, 0, dx, 0, width - dx, strip.getHeight());
+        else
+            strip.moveImageSection(-dx, 0, 0, 0, width + dx, strip.getHeight());
+
+        stripOrigin = origin;
+        renderColumns(dx > 0 ? width - dx : 0, std::abs(dx));
+    }
+
+    repaint();
+}
+
+void ZoomedWaveformDisplay::renderAll()
+{
+    if (strip.getWidth() != getWidth() || strip.getHeight() != getHeight())
+        strip = Image(Image::RGB, getWidth(), getHeight(), false);
+
+    renderColumns(0, strip.getWidth());
+    stripValid = true;
+    stripComplete = pyramid->isComplete();
+    framesSinceFullRender = 0;
+}
+
+void ZoomedWaveformDisplay::renderColumns(int firstColumn, int numColumns)
+{
+    Graphics g(strip);
+    const Rectangle<int> area(firstColumn, 0, numColumns, strip.getHeight());
+
+    g.setColour(backgroundColour);
+    g.fillRect(area);
+
+    g.setColour(waveformColour.withAlpha(0.2f));
+    g.fillRect(area.getX(), area.getCentreY(), area.getWidth(), 1);
+
+    const double start = (double) (stripOrigin + firstColumn) * samplesPerPixel;
+    pyramid->draw(g, area, start, start + numColumns * samplesPerPixel, waveformColour);
+
+    // Grid lines sit on absolute columns, so they scroll with the cached strip like the waveform does
+    const auto length = pyramid->getLengthInSamples();
+    gridOverlay.update(pyramid->getBeatGrid(), pyramid->getSampleRate(), samplesPerPixel, length);
+    gridOverlay.draw(g, area, stripOrigin + firstColumn, Colours::white);
+    BeatGridOverlay::drawCues(g, area, stripOrigin + firstColumn, length / samplesPerPixel, cuePositions);
+}
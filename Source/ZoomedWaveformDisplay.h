@@ -0,0 +1,68 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DJAudioPlayer.h"
+#include "WaveformPyramid.h"
+#include "BeatGrid.h"
+
+//==============================================================================
+/**
+ * Close-up of the few seconds around the playhead, scrolling with the audio
+ * clock on every display refresh.
+ *
+ * The waveform is kept in an image whose columns are locked to absolute pixel
+ * positions in the track. Each frame, the image is shifted by however many
+ * columns the playhead has moved and only the newly exposed columns are drawn
+ * from the pyramid, so steady playback costs a blit plus a few columns a frame.
+ */
+class ZoomedWaveformDisplay : public Component
+{
+public:
+    ZoomedWaveformDisplay(DJAudioPlayer& player, Colour waveformColour,
+        Colour backgroundColour = Colours::black, Colour playheadColour = Colours::red);
+
+    void paint(Graphics& g) override;
+    void resized() override;
+
+    /** Mouse wheel zooms between 1 and 30 seconds across the view */
+    void mouseWheelMove(const MouseEvent& event, const MouseWheelDetails& wheel) override;
+
+    /** Show this track's waveform (may still be filling in on the analysis thread) */
+    void setPyramid(WaveformPyramid::Ptr newPyramid);
+
+    void setVisibleSeconds(double seconds);
+
+    /** Relative hot-cue positions to mark, negative for unset */
+    void setCuePoints(const Array<double>& positions);
+
+private:
+    /** Called on every display refresh */
+    void updateAnimation();
+
+    /** Render columns [firstColumn, firstColumn + numColumns) of the strip, in image coordinates */
+    void renderColumns(int firstColumn, int numColumns);
+    void renderAll();
+
+    DJAudioPlayer& player;
+    WaveformPyramid::Ptr pyramid;
+
+    Image strip;            // Cached rendering of the visible window
+    int64 stripOrigin = 0;  // Absolute track column shown at x = 0 of the strip
+    double samplesPerPixel = 0.0;
+    bool stripValid = false;
+    bool stripComplete = false; // Rendered from a finished pyramid
+    int framesSinceFullRender = 0;
+
+    double visibleSeconds = 6.0;
+
+    BeatGridOverlay gridOverlay; // Line positions for the current zoom
+    Array<double> cuePositions;
+
+    Colour waveformColour;
+    Colour backgroundColour;
+    Colour playheadColour;
+
+    VBlankAttachment vblankAttachment{ this, [this] { updateAnimation(); } };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ZoomedWaveformDisplay)
+};